@@ -0,0 +1,417 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ * usage: encodebench [-h] [-r reps] [-n insts] [-t threads] [-i iters] [-e encodeit]
+ *
+ * args:
+ *    -h          print usage message
+ *    -r reps     timed repetitions per measurement (default 7)
+ *    -n insts    instructions per test case for the generation benchmark
+ *    -t threads  end-to-end runs go from 1 to this many threads (default: cpus)
+ *    -i iters    test cases per thread in the end-to-end runs
+ *    -e encodeit path of the encodeit binary for the end-to-end runs
+ *
+ * Three benchmarks, written to stdout as one JSON document:
+ *
+ *    encoders     every build_* encoder per operand size and displacement
+ *                 form, instructions and bytes per second
+ *    generation   generate_instructions() alone and the whole
+ *                 build_instructions() for one large test case
+ *    end_to_end   test cases per second from encodeit -i at 1..N threads
+ *
+ * Every measurement is repeated and reported as median/mean/min/max/stddev
+ * so regressions can be told from noise.  `make bench` runs it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "generate.h"
+
+#define ENC_INSTS      (1 << 20)        // instructions per encoder repetition
+#define ENC_BUF_BYTES  (256 * 1024)     // encoder target, rewound when full
+
+typedef struct
+{
+  double median, mean, min, max, stddev;
+} stats_t;
+
+typedef struct
+{
+  int type;
+  short size;
+  unsigned char disp_type;
+} enc_case_t;
+
+static const char *type_names[] =
+{
+  [REG2REG] = "reg2reg", [IMM2REG] = "imm2reg", [REG2MEM] = "reg2mem", [MEM2REG] = "mem2reg",
+  [XADD] = "xadd", [XCHG] = "xchg", [MFENCE] = "mfence", [LFENCE] = "lfence", [SFENCE] = "sfence",
+  [ADD2MEM] = "add2mem", [SUB2MEM] = "sub2mem", [AND2MEM] = "and2mem", [OR2MEM] = "or2mem",
+  [XOR2MEM] = "xor2mem", [ADD2REG] = "add2reg", [SUB2REG] = "sub2reg", [AND2REG] = "and2reg",
+  [OR2REG] = "or2reg", [XOR2REG] = "xor2reg", [INCMEM] = "inc", [DECMEM] = "dec",
+  [CMPXCHG] = "cmpxchg", [CMPXCHGB] = "cmpxchg8b16b", [VLOADU] = "vloadu", [VLOADA] = "vloada",
+  [VSTOREU] = "vstoreu", [VSTOREA] = "vstorea", [VSTORENT] = "vstorent",
+};
+static const char *disp_names[] = { "disp0", "disp8", "disp32", "reg" };
+
+int reps = 7;
+
+static double now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return(ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+  double x = *(const double *)a, y = *(const double *)b;
+
+  return((x > y) - (x < y));
+}
+
+static stats_t summarize(double *v, int n)
+{
+  stats_t s = { 0 };
+  double var = 0;
+
+  qsort(v, n, sizeof(double), cmp_double);
+  s.min = v[0];
+  s.max = v[n - 1];
+  s.median = (n & 1) ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+
+  for (int k = 0; k < n; k++)
+  {
+    s.mean += v[k] / n;
+  }
+  for (int k = 0; k < n; k++)
+  {
+    var += (v[k] - s.mean) * (v[k] - s.mean);
+  }
+  s.stddev = (n > 1) ? sqrt(var / (n - 1)) : 0;
+
+  return(s);
+}
+
+static void print_stats(const char *name, stats_t s)
+{
+  printf("\"%s\": { \"median\": %.1f, \"mean\": %.1f, \"min\": %.1f, \"max\": %.1f, \"stddev\": %.1f }",
+         name, s.median, s.mean, s.min, s.max, s.stddev);
+}
+
+/*
+ * Function: encode_case
+ *
+ * Description:
+ *    encodes n instructions of one type/size/displacement form back to back
+ *    through its build_* function, rewinding at the end of the buffer.
+ *    One loop per type so each builder is inlined into its own loop.
+ *
+ * Output:
+ *    bytes encoded
+ */
+#define ENC_LOOP(expr)                                              \
+  for (long k = 0; k < n; k++)                                      \
+  {                                                                 \
+    if (p >= end)                                                   \
+    {                                                               \
+      bytes += p - buf;                                             \
+      p = buf;                                                      \
+    }                                                               \
+    p = (expr);                                                     \
+  }
+
+static long encode_case(const enc_case_t *c, long n, volatile char *buf)
+{
+  volatile char *p = buf, *end = buf + ENC_BUF_BYTES - SAFETY_MARGIN;
+  unsigned char dt = c->disp_type;
+  short sz = c->size;
+  long bytes = 0;
+
+  switch (c->type)
+  {
+    case REG2REG: ENC_LOOP(build_mov_register_to_register(sz, k & 3, (k >> 2) & 3, p)); break;
+    case IMM2REG: ENC_LOOP(build_imm_to_register(sz, k * 0x9e3779b97f4a7c15UL, k & 3, p)); break;
+    case REG2MEM: ENC_LOOP(build_reg_to_memory(sz, k & 3, REG_EDI, dt, k & 0x7f, p)); break;
+    case MEM2REG: ENC_LOOP(build_mov_memory_to_register(sz, REG_EDI, k & 3, dt, k & 0x7f, p)); break;
+    case XADD:    ENC_LOOP(build_xadd(sz, k & 3, REG_EDI, dt, k & 0x7f, k & 1, p)); break;
+    case XCHG:    ENC_LOOP(build_xchg(sz, k & 3, REG_EDI, dt, k & 0x7f, k & 1, p)); break;
+    case MFENCE:  ENC_LOOP(build_mfence(p)); break;
+    case LFENCE:  ENC_LOOP(build_lfence(p)); break;
+    case SFENCE:  ENC_LOOP(build_sfence(p)); break;
+
+    case ADD2MEM: case SUB2MEM: case AND2MEM: case OR2MEM: case XOR2MEM:
+      ENC_LOOP(build_alu_reg_to_memory(c->type, sz, k & 3, REG_EDI, dt, k & 0x7f, k & 1, p)); break;
+
+    case ADD2REG: case SUB2REG: case AND2REG: case OR2REG: case XOR2REG:
+      ENC_LOOP(build_alu_memory_to_register(c->type, sz, REG_EDI, k & 3, dt, k & 0x7f, p)); break;
+
+    case INCMEM: case DECMEM:
+      ENC_LOOP(build_inc_dec(c->type, sz, REG_EDI, dt, k & 0x7f, k & 1, p)); break;
+
+    case CMPXCHG: ENC_LOOP(build_cmpxchg(sz, k & 3, REG_EDI, dt, k & 0x7f, k & 1, p)); break;
+    case CMPXCHGB: ENC_LOOP(build_cmpxchg8b16b(sz, REG_EDI, dt, k & 0x70, k & 1, p)); break;
+
+    // multiples of 64 keep EVEX disp8 encodable
+    case VLOADU: case VLOADA:
+      ENC_LOOP(build_vec_load(c->type, sz, k & 7, REG_EDI, dt, k & 0x40, p)); break;
+
+    case VSTOREU: case VSTOREA: case VSTORENT:
+      ENC_LOOP(build_vec_store(c->type, sz, k & 7, REG_EDI, dt, k & 0x40, p)); break;
+  }
+
+  return(bytes + (p - buf));
+}
+
+static void bench_encoders(void)
+{
+  static const short sizes[] = { ISZ_1, ISZ_2, ISZ_4, ISZ_8 };
+  static const short widths[] = { VSZ_16, VSZ_32, VSZ_64 };
+  static const unsigned char disps[] = { DISP0_MODRM, DISP8_MODRM, DISP32_MODRM };
+  volatile char *buf = malloc(ENC_BUF_BYTES);
+  double *ips = calloc(reps, sizeof(double)), *bps = calloc(reps, sizeof(double));
+  enc_case_t cases[NUM_TYPES * 4 * 3];
+  int ncases = 0, first = 1;
+
+  if (!buf || !ips || !bps)
+  {
+    perror("malloc");
+    exit(1);
+  }
+
+  for (int type = REG2REG; type < NUM_TYPES; type++)
+  {
+    int is_fence = (type == MFENCE || type == LFENCE || type == SFENCE);
+    int is_mem = !is_fence && type != REG2REG && type != IMM2REG;
+    int nsizes = is_fence ? 1 : IS_VEC(type) ? 3 : 4;
+
+    for (int s = (type == CMPXCHGB) ? 2 : 0; s < nsizes; s++)
+    {
+      for (int d = 0; d < (is_mem ? 3 : 1); d++)
+      {
+        cases[ncases++] = (enc_case_t){ type, IS_VEC(type) ? widths[s] : sizes[s], is_mem ? disps[d] : BASE_MODRM };
+      }
+    }
+  }
+
+  printf("  \"encoders\": [\n");
+  for (int c = 0; c < ncases; c++)
+  {
+    fprintf(stderr, "encoder %s size %d %s\n", type_names[cases[c].type], cases[c].size,
+            disp_names[cases[c].disp_type >> MODRM_SHIFT]);
+
+    encode_case(&cases[c], ENC_INSTS / 16, buf);     // warm up
+
+    for (int r = 0; r < reps; r++)
+    {
+      double t0 = now();
+      long bytes = encode_case(&cases[c], ENC_INSTS, buf);
+      double t = now() - t0;
+
+      ips[r] = ENC_INSTS / t;
+      bps[r] = bytes / t;
+    }
+
+    printf("%s    { \"type\": \"%s\", \"size\": %d, \"disp\": \"%s\", ", first ? "" : ",\n",
+           type_names[cases[c].type], cases[c].size, disp_names[cases[c].disp_type >> MODRM_SHIFT]);
+    print_stats("insts_per_s", summarize(ips, reps));
+    printf(", ");
+    print_stats("bytes_per_s", summarize(bps, reps));
+    printf(" }");
+    first = 0;
+  }
+  printf("\n  ],\n");
+
+  free((void *)buf);
+  free(ips);
+  free(bps);
+}
+
+static void bench_generation(int num_inst)
+{
+  long code_bytes = (long)num_inst * MAX_INSN_BYTES + FRAME_BYTES + SAFETY_MARGIN;
+  volatile char *code = malloc(code_bytes);
+  double *gen = calloc(reps, sizeof(double)), *build = calloc(reps, sizeof(double));
+  insn_ir_t ir;
+  rng_t rng;
+
+  if (!code || !gen || !build || ir_alloc(&ir, num_inst) == -1)
+  {
+    perror("malloc");
+    exit(1);
+  }
+
+  fprintf(stderr, "generation, %d instructions\n", num_inst);
+
+  // warm up, faults in the code buffer and the IR
+  rng_seed(&rng, 0, 0, 0);
+  build_instructions(code, code_bytes, 0, num_inst, &rng, &ir);
+
+  for (int r = 0; r < reps; r++)
+  {
+    double t0;
+
+    rng_seed(&rng, 0, 0, r + 1);
+    t0 = now();
+    generate_instructions(&ir, num_inst, 0, &rng);
+    gen[r] = ir.count / (now() - t0);
+
+    rng_seed(&rng, 0, 0, r + 1);
+    t0 = now();
+    build[r] = build_instructions(code, code_bytes, 0, num_inst, &rng, &ir) / (now() - t0);
+  }
+
+  printf("  \"generation\": { \"insts\": %d, ", num_inst);
+  print_stats("generate_insts_per_s", summarize(gen, reps));
+  printf(", ");
+  print_stats("build_insts_per_s", summarize(build, reps));
+  printf(" },\n");
+
+  ir_free(&ir);
+  free((void *)code);
+  free(gen);
+  free(build);
+}
+
+/*
+ * Function: run_encodeit
+ *
+ * Description:
+ *    one encodeit run, tests/s as it reports it: timed from releasing the
+ *    workers to the last one exiting, so fork and setup are not included
+ *
+ * Output:
+ *    tests/s, or -1 if the run failed or its summary couldn't be parsed
+ */
+static double run_encodeit(const char *encodeit, int threads, int iters)
+{
+  char cmd[512], line[512];
+  double tps = -1;
+  FILE *f;
+
+  snprintf(cmd, sizeof(cmd), "%s -s 1 -t %d -i %d 2>&1 >/dev/null", encodeit, threads, iters);
+  if ((f = popen(cmd, "r")) == NULL)
+  {
+    perror(cmd);
+    return(-1);
+  }
+
+  while (fgets(line, sizeof(line), f))
+  {
+    char *p = strstr(line, " s: ");
+
+    if (strstr(line, "test cases (") && p)
+    {
+      tps = strtod(p + 4, NULL);
+    }
+  }
+
+  if (pclose(f) != 0)
+  {
+    fprintf(stderr, "%s failed\n", cmd);
+    return(-1);
+  }
+
+  return(tps);
+}
+
+static void bench_end_to_end(const char *encodeit, int max_threads, int iters)
+{
+  double *tps = calloc(reps, sizeof(double));
+
+  if (!tps)
+  {
+    perror("calloc");
+    exit(1);
+  }
+
+  printf("  \"end_to_end\": [\n");
+  for (int t = 1; t <= max_threads; t++)
+  {
+    int ok = 0;
+
+    fprintf(stderr, "end to end, %d threads\n", t);
+
+    for (int r = 0; r < reps; r++)
+    {
+      if ((tps[ok] = run_encodeit(encodeit, t, iters)) >= 0)
+      {
+        ok++;
+      }
+    }
+
+    printf("%s    { \"threads\": %d, \"iters\": %d, \"runs\": %d", t == 1 ? "" : ",\n", t, iters, ok);
+    if (ok)
+    {
+      printf(", ");
+      print_stats("tests_per_s", summarize(tps, ok));
+    }
+    printf(" }");
+  }
+  printf("\n  ]\n");
+
+  free(tps);
+}
+
+int main(int argc, char *argv[])
+{
+  int opt;
+  int num_inst = 100000;
+  int max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  int iters = 2000;
+  const char *encodeit = "./encodeit";
+
+  while ((opt = getopt(argc, argv, "hr:n:t:i:e:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'r':
+        reps = strtol(optarg, NULL, 0);
+        break;
+
+      case 'n':
+        num_inst = strtol(optarg, NULL, 0);
+        break;
+
+      case 't':
+        max_threads = strtol(optarg, NULL, 0);
+        break;
+
+      case 'i':
+        iters = strtol(optarg, NULL, 0);
+        break;
+
+      case 'e':
+        encodeit = optarg;
+        break;
+
+      case 'h':
+      default:
+        fprintf(stderr, "usage: encodebench [-h] [-r reps] [-n insts] [-t threads] [-i iters] [-e encodeit]\n");
+        exit(1);
+    }
+  }
+
+  if (reps < 1) reps = 1;
+  if (num_inst < 1) num_inst = 1;
+  if (max_threads < 1) max_threads = 1;
+  if (iters < 1) iters = 1;
+
+  gen_cfg.quiet = 1;
+  gen_vec_init(VSZ_64);
+
+  printf("{\n  \"reps\": %d,\n", reps);
+  bench_encoders();
+  bench_generation(num_inst);
+  bench_end_to_end(encodeit, max_threads, iters);
+  printf("}\n");
+
+  return 0;
+}
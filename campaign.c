@@ -0,0 +1,251 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ * Seed sweep campaigns, see include/campaign.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "campaign.h"
+
+_Static_assert(sizeof(campaign_hdr_t) <= CAMPAIGN_REC_OFF, "campaign header overlaps the records");
+
+#define RANGE(next, end)   ((unsigned long)(unsigned int)(next) | (unsigned long)(end) << 32)
+#define RANGE_NEXT(r)      ((int)((r) & 0xffffffffUL))
+#define RANGE_END(r)       ((int)((r) >> 32))
+
+static campaign_t *interrupted;
+
+static void campaign_interrupt(int signo)
+{
+  (void)signo;
+  interrupted->sched->stop = 1;
+}
+
+int campaign_open(campaign_t *c, const char *path, const campaign_hdr_t *info, int ngroups)
+{
+  campaign_hdr_t want = *info;
+  struct stat st;
+  void *p;
+
+  memset(c, 0, sizeof(*c));
+  want.magic = CAMPAIGN_MAGIC;
+  want.version = CAMPAIGN_VERSION;
+  c->len = CAMPAIGN_REC_OFF + (long)info->count * sizeof(campaign_rec_t);
+
+  if ((c->fd = open(path, O_RDWR | O_CREAT, 0644)) == -1 || fstat(c->fd, &st) == -1)
+  {
+    perror(path);
+    return(-1);
+  }
+
+  // an existing file has to be this campaign's, or we'd mix two of them
+  if (st.st_size)
+  {
+    campaign_hdr_t old;
+
+    if (pread(c->fd, &old, sizeof(old), 0) != sizeof(old) || memcmp(&old, &want, sizeof(want)) ||
+        st.st_size != c->len)
+    {
+      fprintf(stderr, "%s: results of a different campaign (seed range or settings), not resuming it\n", path);
+      close(c->fd);
+      return(-1);
+    }
+  }
+  else if (pwrite(c->fd, &want, sizeof(want), 0) != sizeof(want) || ftruncate(c->fd, c->len) == -1)
+  {
+    perror(path);
+    close(c->fd);
+    return(-1);
+  }
+
+  if ((p = mmap(NULL, c->len, PROT_READ | PROT_WRITE, MAP_SHARED, c->fd, 0)) == MAP_FAILED)
+  {
+    perror(path);
+    close(c->fd);
+    return(-1);
+  }
+  c->hdr = p;
+  c->rec = (campaign_rec_t *)((char *)p + CAMPAIGN_REC_OFF);
+
+  c->sched_len = sizeof(campaign_sched_t) + ngroups * sizeof(c->sched->queue[0]);
+  c->sched = mmap(NULL, c->sched_len, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_SHARED, -1, 0);
+  if (c->sched == MAP_FAILED)
+  {
+    perror("campaign scheduler");
+    munmap(p, c->len);
+    close(c->fd);
+    return(-1);
+  }
+
+  for (int k = 0; k < info->count; k++)
+  {
+    c->resumed += (c->rec[k].flags & CAMP_DONE) != 0;
+  }
+
+  // one contiguous batch per group, the first count % ngroups a seed longer
+  c->sched->ngroups = ngroups;
+  for (int g = 0, next = 0; g < ngroups; g++)
+  {
+    int len = info->count / ngroups + (g < info->count % ngroups);
+
+    c->sched->queue[g].range = RANGE(next, next + len);
+    next += len;
+  }
+
+  return(0);
+}
+
+/*
+ * Function: take_own
+ *
+ * Description:
+ *    the front seed of group g's batch
+ *
+ * Output:
+ *    seed index, -1 if the batch is empty
+ */
+static int take_own(campaign_sched_t *s, int g)
+{
+  unsigned long r = s->queue[g].range;
+
+  while (RANGE_NEXT(r) < RANGE_END(r))
+  {
+    if (__atomic_compare_exchange_n(&s->queue[g].range, &r, RANGE(RANGE_NEXT(r) + 1, RANGE_END(r)),
+                                    0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+      return(RANGE_NEXT(r));
+    }
+  }
+
+  return(-1);
+}
+
+/*
+ * Function: steal
+ *
+ * Description:
+ *    moves the back half of the largest batch (all of it if one seed is
+ *    left) into group g's empty one
+ *
+ * Output:
+ *    1 if something was stolen, 0 if every batch is empty
+ */
+static int steal(campaign_sched_t *s, int g)
+{
+  for (;;)
+  {
+    int victim = -1, most = 0;
+    unsigned long r;
+
+    for (int v = 0; v < s->ngroups; v++)
+    {
+      r = s->queue[v].range;
+      if (v != g && RANGE_END(r) - RANGE_NEXT(r) > most)
+      {
+        most = RANGE_END(r) - RANGE_NEXT(r);
+        victim = v;
+      }
+    }
+
+    if (victim < 0)
+    {
+      return(0);
+    }
+
+    r = s->queue[victim].range;
+    if (RANGE_END(r) > RANGE_NEXT(r))
+    {
+      int mid = RANGE_NEXT(r) + (RANGE_END(r) - RANGE_NEXT(r)) / 2;
+
+      if (__atomic_compare_exchange_n(&s->queue[victim].range, &r, RANGE(RANGE_NEXT(r), mid),
+                                      0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+      {
+        // an empty batch isn't stolen from, so only its owner writes it now
+        __atomic_store_n(&s->queue[g].range, RANGE(mid, RANGE_END(r)), __ATOMIC_RELEASE);
+        return(1);
+      }
+    }
+  }
+}
+
+int campaign_next(campaign_t *c, int g)
+{
+  campaign_sched_t *s = c->sched;
+  int k;
+
+  while (!s->stop)
+  {
+    if ((k = take_own(s, g)) < 0)
+    {
+      if (!steal(s, g))
+      {
+        return(-1);
+      }
+      continue;
+    }
+
+    // resumed: done by the run that wrote the file
+    if (!(c->rec[k].flags & CAMP_DONE))
+    {
+      return(c->hdr->start + k);
+    }
+  }
+
+  return(-1);
+}
+
+void campaign_commit(campaign_t *c, int g, const campaign_rec_t *r)
+{
+  campaign_rec_t *dst = campaign_rec(c, r->seed);
+  campaign_rec_t tmp = *r;
+
+  // the record is only done once all of it is there
+  tmp.flags = 0;
+  memcpy(dst, &tmp, sizeof(*dst));
+  __atomic_store_n(&dst->flags, r->flags | CAMP_DONE, __ATOMIC_RELEASE);
+
+  // the page cache survives us being killed, this is for the machine going down
+  if (++c->sched->queue[g].commits % CAMPAIGN_SYNC == 0)
+  {
+    msync(c->hdr, c->len, MS_SYNC);
+  }
+}
+
+void campaign_catch_interrupt(campaign_t *c)
+{
+  struct sigaction sa = { 0 };
+
+  interrupted = c;
+  sa.sa_handler = campaign_interrupt;
+  sa.sa_flags = SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+}
+
+void campaign_close(campaign_t *c)
+{
+  if (c->hdr)
+  {
+    msync(c->hdr, c->len, MS_SYNC);
+    munmap(c->hdr, c->len);
+  }
+  if (c->sched)
+  {
+    munmap(c->sched, c->sched_len);
+  }
+  close(c->fd);
+  c->hdr = NULL;
+  c->rec = NULL;
+  c->sched = NULL;
+}
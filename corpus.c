@@ -0,0 +1,214 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ * Test corpus files, see include/corpus.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "corpus.h"
+
+#define CORPUS_ALIGN   64           // IR and data sections, code is page aligned
+
+static long align_up(long val, long align)
+{
+  return((val + align - 1) / align * align);
+}
+
+static int write_at(int fd, const volatile void *buf, long len, long off, const char *path)
+{
+  if (pwrite(fd, (const void *)buf, len, off) != len)
+  {
+    perror(path);
+    return(-1);
+  }
+
+  return(0);
+}
+
+int corpus_write(const char *path, const corpus_hdr_t *info, const corpus_test_t *tests)
+{
+  int n = info->nthreads;
+  int images = info->shared_data ? 1 : n;
+  long hdr_len = sizeof(corpus_hdr_t) + n * sizeof(corpus_thread_t);
+  long code_bytes = align_up(info->code_bytes, PAGESIZE);
+  long off;
+  corpus_hdr_t *hdr;
+  int fd, rc = 0;
+
+  if ((hdr = calloc(1, hdr_len)) == NULL)
+  {
+    perror("corpus header");
+    return(-1);
+  }
+
+  *hdr = *info;
+  hdr->magic = CORPUS_MAGIC;
+  hdr->version = CORPUS_VERSION;
+  hdr->code_bytes = code_bytes;
+
+  // lay the sections out: code pages, then the IR and data images packed
+  off = align_up(hdr_len, PAGESIZE);
+  for (int t = 0; t < n; t++)
+  {
+    hdr->thread[t].code_off = off;
+    off += code_bytes;
+  }
+  for (int t = 0; t < n; t++)
+  {
+    hdr->thread[t].ir_off = off;
+    off += align_up(IR_BYTES(tests[t].ir->count), CORPUS_ALIGN);
+  }
+  for (int t = 0; t < n; t++)
+  {
+    hdr->thread[t].data_off = off + (t % images) * info->data_bytes;
+  }
+  off += images * info->data_bytes;
+
+  for (int t = 0; t < n; t++)
+  {
+    hdr->thread[t].cpu = tests[t].cpu;
+    hdr->thread[t].iteration = tests[t].iteration;
+    hdr->thread[t].count = tests[t].ir->count;
+    hdr->thread[t].loops = tests[t].ir->loops;
+    hdr->thread[t].sig = tests[t].sig;
+    memcpy(hdr->thread[t].init_regs, tests[t].ir->init_regs, sizeof(hdr->thread[t].init_regs));
+  }
+
+  if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1)
+  {
+    perror(path);
+    free(hdr);
+    return(-1);
+  }
+
+  rc = write_at(fd, hdr, hdr_len, 0, path);
+
+  for (int t = 0; t < n && rc == 0; t++)
+  {
+    const insn_ir_t *src = tests[t].ir;
+    char *block = malloc(IR_BYTES(src->count) + sizeof(long));
+    insn_ir_t packed;
+
+    if (block == NULL)
+    {
+      perror("corpus IR");
+      rc = -1;
+      break;
+    }
+
+    // the writer's IR has room for cap, the file holds exactly count
+    ir_carve(&packed, block, src->count);
+    for (int i = 0; i < src->count; i++)
+    {
+      ir_copy_insn(&packed, i, src, i);
+    }
+
+    rc = write_at(fd, tests[t].code, info->code_bytes, hdr->thread[t].code_off, path);
+    if (rc == 0)
+    {
+      rc = write_at(fd, block, IR_BYTES(src->count), hdr->thread[t].ir_off, path);
+    }
+    if (rc == 0 && t < images)
+    {
+      rc = write_at(fd, tests[t].data, info->data_bytes, hdr->thread[t].data_off, path);
+    }
+    free(block);
+  }
+
+  // the code sections are mapped whole pages at a time
+  if (rc == 0 && ftruncate(fd, off) == -1)
+  {
+    perror(path);
+    rc = -1;
+  }
+
+  close(fd);
+  free(hdr);
+  return(rc);
+}
+
+int corpus_open(corpus_t *c, const char *path)
+{
+  struct stat st;
+  int fd = open(path, O_RDONLY);
+  const corpus_hdr_t *hdr;
+
+  c->map = NULL;
+  if (fd == -1 || fstat(fd, &st) == -1)
+  {
+    perror(path);
+    if (fd != -1)
+    {
+      close(fd);
+    }
+    return(-1);
+  }
+
+  c->len = st.st_size;
+  if (c->len < (long)sizeof(corpus_hdr_t))
+  {
+    fprintf(stderr, "%s: not a corpus file\n", path);
+    close(fd);
+    return(-1);
+  }
+
+  c->map = mmap(NULL, c->len, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (c->map == MAP_FAILED)
+  {
+    perror(path);
+    c->map = NULL;
+    return(-1);
+  }
+  c->hdr = hdr = (const corpus_hdr_t *)c->map;
+
+  if (hdr->magic != CORPUS_MAGIC || hdr->version != CORPUS_VERSION || hdr->nthreads < 1 ||
+      (long)(sizeof(corpus_hdr_t) + hdr->nthreads * sizeof(corpus_thread_t)) > c->len)
+  {
+    fprintf(stderr, "%s: not a version %d corpus file\n", path, CORPUS_VERSION);
+    corpus_close(c);
+    return(-1);
+  }
+
+  for (int t = 0; t < hdr->nthreads; t++)
+  {
+    const corpus_thread_t *ct = &hdr->thread[t];
+
+    if (ct->code_off % PAGESIZE || ct->code_off + hdr->code_bytes > c->len ||
+        ct->ir_off + (long)IR_BYTES(ct->count) > c->len || ct->data_off + hdr->data_bytes > c->len)
+    {
+      fprintf(stderr, "%s: thread %d sections are outside the file\n", path, t);
+      corpus_close(c);
+      return(-1);
+    }
+
+    // run the code where it lies, read only
+    if (mprotect(c->map + ct->code_off, hdr->code_bytes, PROT_READ | PROT_EXEC) == -1)
+    {
+      fprintf(stderr, "%s: can't map code executable: ", path);
+      perror("");
+      corpus_close(c);
+      return(-1);
+    }
+  }
+
+  return(0);
+}
+
+void corpus_close(corpus_t *c)
+{
+  if (c->map)
+  {
+    munmap(c->map, c->len);
+  }
+  c->map = NULL;
+}
@@ -2,14 +2,73 @@
  * ECE550 Spring 2025 Project part 3
  * R.E. Lamb, Harsha Duvvuru
  *
- * usage: encodeit [-h] [-s seed] [-n insts] [-t threads] [-l logfile]
+ * usage: encodeit [-h] [-s seed] [-n insts] [-t threads] [-l logfile] [-i iters]
  *
  * args:
  *    -h          print usage message
  *    -s seed     set random seed
  *    -n insts    set number to generate
  *    -t threads  set number of threads
- *    -l logfile  set logfile name
+ *    -l logfile  write the binary event log to logfile as text at exit
+ *    -i iters    set number of test cases each thread generates and runs
+ *    -c bytes    code buffer size per thread (default: sized from -n)
+ *    -d bytes    data buffer size per thread
+ *    -H          back the code and data regions with huge pages
+ *    -p policy   cpu placement: linear, compact, smt, core, socket, spread
+ *    -C cpulist  explicit cpu list for the threads, e.g. 0,2,8-11
+ *    -B          don't emit the start/end spin barriers into the generated code
+ *    -G          don't check results against the golden model
+ *    -U          uniform: every thread runs thread 0's test cases, and
+ *                threads whose signature differs from the rest are flagged
+ *    -D hotset   all threads share one data region, memory operands go to a
+ *                hot set: lines[,pct[,true|false]], e.g. -D 4,80,false puts
+ *                80% of accesses on 4 lines, each thread on its own bytes
+ *    -M mix      weighted instruction mix, key=weight list or @file, see
+ *                include/profile.h; e.g. -M xadd=1,xchg=1,lock=100
+ *    -P          count cycles, instructions, machine clears, cache misses and
+ *                locked loads around the generated code (TSC is always timed)
+ *    -V width    widest vector load/store to generate, 16, 32 or 64 bytes
+ *                (default: the widest the CPU supports)
+ *    -m workers  on the first failing test case (golden mismatch or crash)
+ *                stop that thread and shrink the test case to a minimal
+ *                reproducer, running candidates on this many pinned
+ *                processes, see include/minimize.h.  Candidates run
+ *                the failing thread alone, so failures that need the
+ *                other threads (races, -U mismatches) aren't reduced.
+ *    -T mode     run the test threads as forked processes (fork, the
+ *                default) or as pthreads sharing one address space
+ *                (pthread); the regions are the same shared mappings
+ *                either way.  A crash takes the whole run down in
+ *                pthread mode, so -m only minimizes mismatches there.
+ *    -b          double buffer: a generator thread per worker builds test
+ *                case N+1 into a second code buffer while N runs
+ *    -w corpus   save the test case each thread ran last (the failing one
+ *                with -m) with its starting data to a corpus file, see
+ *                include/corpus.h
+ *    -R          replay: the operands are corpus files, each is run -i
+ *                times from its saved code and data and checked against
+ *                the golden model and the saved signatures; the saved
+ *                CPUs are used unless -p/-C is given
+ *    -S start:count[:groups]
+ *                campaign: run seeds start..start+count-1, each as -s
+ *                would with -t threads and -i test cases, on groups of -t
+ *                pinned workers (default: as many as the CPUs allow) that
+ *                steal seeds from each other, see include/campaign.h
+ *    -o results  campaign results file, one record per seed; rerunning
+ *                the same campaign on it resumes where it stopped
+ *    -L test     litmus mode: run a memory ordering litmus test, sb, mp,
+ *                lb or iriw with an optional +mfence or +lock, for -i
+ *                iterations (up to 1024 per call into the generated code)
+ *                with a barrier before every one, and print the histogram
+ *                of outcomes; -t follows the test, see include/litmus.h
+ *    -k count[,sync]
+ *                run every random body count times in a loop inside the
+ *                generated code instead of once, so the threads overlap
+ *                for longer per call; with sync all threads take a spin
+ *                barrier at the top of every iteration.  r15 becomes the
+ *                loop counter and is left out of the random body.
+ *
+ *    sizes take an optional k/m/g suffix
  *
  */
 
@@ -20,51 +79,221 @@
 #include <sys/types.h>
 #include <sys/mman.h>
 #include <sys/wait.h>
+#include <sys/syscall.h>
+#include <linux/memfd.h>
 #include <unistd.h>
 #include <limits.h>
 #include <semaphore.h>
+#include <time.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+#include <cpuid.h>
 
 #define __USE_GNU
 #include <sched.h>
 
 #include "ia32_encode.h"
+#include "rng.h"
+#include "insn_ir.h"
+#include "evlog.h"
+#include "topology.h"
+#include "generate.h"
+#include "golden.h"
+#include "signature.h"
+#include "perfctr.h"
+#include "minimize.h"
+#include "corpus.h"
+#include "fault.h"
+#include "campaign.h"
+#include "litmus.h"
+
+typedef int (*funct_t)(volatile char *data, void *ctx);
 
-typedef int (*funct_t)();
+// executeit() results
+#define EXEC_PASS      0
+#define EXEC_MISMATCH  1
+#define EXEC_FAULT     2
 typedef struct { volatile char *pointer_addr; } test_i;
 typedef volatile char *tptrs;
 
+// -S: a worker group's state between seeds
+typedef struct
+{
+  barrier_t sync;             // C side barrier around every seed
+  volatile int seed;          // taken by worker 0, -1 once there are none left
+} __attribute__((aligned(64))) camp_group_t;
+
+#define CAMP_SHOW      10     // failing seeds listed in the summary
+
+// -b: one half of a worker's double buffer
+typedef struct
+{
+  volatile int full;          // set by the generator once built, cleared by the worker once run
+  int built;                  // instructions in the test case
+  insn_ir_t ir;
+  volatile char *code;        // RW view of the slot's code buffer
+} code_slot_t;
+
+typedef struct
+{
+  int thread_id;
+  volatile int stop;          // the worker quit early, the generator stops waiting
+  code_slot_t slot[2];
+} pipeline_t;
+
+// per-thread results, published to the parent through the comm area
+typedef struct
+{
+  volatile long iterations;   // test cases completed
+  volatile long insts;        // instructions generated over all iterations
+  volatile long fails;        // test cases executeit() reported as failed
+  volatile unsigned long sig;       // signatures of every test case, chained
+  volatile unsigned long last_sig;  // signature of the last test case
+  volatile long first_fail;   // -m: iteration of the failed test case + 1, 0 for none
+  volatile long faults;       // test cases the generated code faulted in
+  volatile long fault_iter;   // the first of them: test case,
+  volatile long fault_off;    // rip as an offset into it,
+  volatile int fault_insn;    // the instruction there, -1 in the preamble,
+  fault_t fault;              // and the signal
+  perfctr_counts_t perf;      // counters and TSC around the generated code
+  volatile int cpu;           // CPU the thread was pinned to, -1 if pinning failed
+} __attribute__((aligned(64))) thread_result_t;
+
 // globals to aid debug to start
 volatile char *mptr = 0,*next_ptr = 0,*mdptr = 0, *comm_ptr = 0;
+volatile char *mxptr = 0;     // RX view of the code region, mptr is the RW one
+int seed = 0;
 int num_inst = 25;
 int nthreads = 1;
+int iterations = 1;
+int quiet = 0;
+long instr_bytes = 0;
+long data_bytes = DEF_DATA_BYTES;
+int huge_pages = 0;
+int use_golden = 1;
+int uniform = 0;
+int use_pmu = 0;
+int vec_width = 0;
+int min_workers = 0;
+int use_pthreads = 0;
+int pipelined = 0;
+char *corpus_out = NULL;
+char *campaign_out = NULL;
+int camp_start = 0;
+int camp_count = 0;
+int ngroups = 1;                // campaign worker groups, nthreads workers each
+int nworkers = 1;               // nthreads * ngroups
+campaign_t camp;
+int use_litmus = 0;
+litmus_t litmus;
 
-int pid_task[MAX_THREADS];
+int *pid_task;
+int *thread_status;             // waitpid status, 0 for pthreads
+pthread_t *tid_task;
+int *thread_cpu;
 test_i test_info[NUM_PTRS];
-volatile char *mptr_threads[MAX_THREADS];
-volatile char *mdptr_threads[MAX_THREADS];
+volatile char **mptr_threads;
+volatile char **mdptr_threads;
 
+thread_result_t *results;
+thread_ctx_t *thread_ctx;
+barrier_t *barrier;            // one per group
+camp_group_t *groups;
+evlog_t *evlogs = NULL;
+volatile char *snapshots = NULL;
 sem_t* barrier_start;
-funct_t start_test;
 
-int build_instructions(volatile char*, int, int);
-int executeit();
+int executeit(funct_t, volatile char*, thread_ctx_t*, golden_t*, perfctr_t*, perfctr_counts_t*, int);
+unsigned long test_signature(volatile char*, thread_ctx_t*);
+int report_signatures(void);
+int pin_worker(int, int);
+void log_instructions(evlog_t*, insn_ir_t*, unsigned int);
+void dump_event_log(FILE*, evlog_t*, int);
+const char *ev_reg_name(int, int, int);
+long parse_size(const char*);
+int parse_hotset(const char*);
+int parse_campaign(const char*);
+int parse_loop(const char*);
+long round_up(long, long);
+volatile char *alloc_region(long, int, const char*);
+void minimize_failure(int, const char*, const char*);
+void write_corpus(const char*, const char*, const char*);
+int replay_corpus(const char*, const char*, const char*, long*);
+long last_test_case(int);
+void *run_worker(void*);
+void *run_campaign_worker(void*);
+void *run_litmus_worker(void*);
+int run_test_case(int, funct_t, insn_ir_t*, golden_t*, perfctr_t*, long);
+void commit_seed(int, int);
+int report_campaign(double);
+void *run_generator(void*);
+void record_fault(int, long, funct_t, const insn_ir_t*);
+void report_faults(void);
+volatile char *alloc_code_region(long, volatile char**);
+void *map_code_views(int, long, volatile char**);
+
+/*
+ * Function: slot_wait
+ *
+ * Description:
+ *    acquire side of a code slot handoff: spin until the flag reads want,
+ *    then yield, the other side may be on the same CPU
+ *
+ * Output:
+ *    0 once the flag is set, -1 if stop was raised first
+ */
+static inline int slot_wait(volatile int *flag, int want, volatile int *stop)
+{
+  for (int spins = 0; __atomic_load_n(flag, __ATOMIC_ACQUIRE) != want; spins++)
+  {
+    if (stop && *stop)
+    {
+      return(-1);
+    }
+
+    if (spins < 1000)
+    {
+      _mm_pause();
+    }
+    else
+    {
+      sched_yield();
+    }
+  }
+
+  return(0);
+}
 
-int rand_range(int min_n, int max_n)
+// cross-modifying code: the executing side serializes after the flag, before the new code
+static inline void serialize(void)
 {
-  return rand() % (max_n - min_n + 1) + min_n;
+  unsigned int a, b, c, d;
+
+  __cpuid(0, a, b, c, d);
 }
 
 int main(int argc, char *argv[])
 {
   int opt, i, pid;
-  int seed = 0;
-  int ibuilt = 0;
+  int min_thread = -1;
+  int replay = 0;
   int rc = 0;
   char* logfile = NULL;
-  int cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  char* placement = NULL;
+  char* cpulist = NULL;
+  static profile_t mix;
+  long total_tests = 0, total_insts = 0, total_fails = 0, total_faults = 0;
+  perfctr_counts_t total_perf = { 0 };
+  struct timespec t_start, t_end;
+  double elapsed;
+  long code_total, data_total, comm_total;
   
+  // crc32 dispatch is picked once here, sig_hash() is called from every worker
+  sig_init();
+
   // parse command line
-  while ((opt = getopt(argc, argv, "hs:n:t:l:")) != -1)
+  while ((opt = getopt(argc, argv, "hs:n:t:l:i:c:d:Hp:C:BGUPD:M:V:m:T:bw:RS:o:L:k:")) != -1)
   {
     switch (opt)
     {
@@ -84,67 +313,365 @@ int main(int argc, char *argv[])
         logfile = optarg;
         break;
 
+      case 'i':
+        iterations = strtol(optarg, NULL, 0);
+        break;
+
+      case 'c':
+        instr_bytes = parse_size(optarg);
+        break;
+
+      case 'd':
+        data_bytes = parse_size(optarg);
+        break;
+
+      case 'H':
+        huge_pages = 1;
+        break;
+
+      case 'p':
+        placement = optarg;
+        break;
+
+      case 'C':
+        cpulist = optarg;
+        break;
+
+      case 'B':
+        gen_cfg.use_barrier = 0;
+        break;
+
+      case 'G':
+        use_golden = 0;
+        break;
+
+      case 'U':
+        uniform = 1;
+        break;
+
+      case 'P':
+        use_pmu = 1;
+        break;
+
+      case 'V':
+        vec_width = atoi(optarg);
+        if (vec_width != VSZ_16 && vec_width != VSZ_32 && vec_width != VSZ_64)
+        {
+          fprintf(stderr, "vector width must be 16, 32 or 64 bytes\n");
+          exit(1);
+        }
+        break;
+
+      case 'w':
+        corpus_out = optarg;
+        break;
+
+      case 'R':
+        replay = 1;
+        break;
+
+      case 'S':
+        if (parse_campaign(optarg) == -1)
+        {
+          fprintf(stderr, "bad campaign \"%s\", expected start:count[:groups]\n", optarg);
+          exit(1);
+        }
+        break;
+
+      case 'o':
+        campaign_out = optarg;
+        break;
+
+      case 'L':
+        if (litmus_parse(&litmus, optarg) == -1)
+        {
+          fprintf(stderr, "unknown litmus test \"%s\", expected sb, mp, lb or iriw, optionally +mfence or +lock\n", optarg);
+          exit(1);
+        }
+        use_litmus = 1;
+        break;
+
+      case 'k':
+        if (parse_loop(optarg) == -1)
+        {
+          fprintf(stderr, "bad loop \"%s\", expected count[,sync]\n", optarg);
+          exit(1);
+        }
+        break;
+
+      case 'b':
+        pipelined = 1;
+        break;
+
+      case 'T':
+        if (strcmp(optarg, "pthread") == 0)
+        {
+          use_pthreads = 1;
+        }
+        else if (strcmp(optarg, "fork") != 0)
+        {
+          fprintf(stderr, "execution mode must be fork or pthread\n");
+          exit(1);
+        }
+        break;
+
+      case 'm':
+        min_workers = strtol(optarg, NULL, 0);
+        if (min_workers < 1 || min_workers > MIN_MAX_WORKERS)
+        {
+          fprintf(stderr, "minimizer workers must be between 1 and %d\n", MIN_MAX_WORKERS);
+          exit(1);
+        }
+        break;
+
+      case 'M':
+        if (profile_parse(&mix, optarg) == -1)
+        {
+          exit(1);
+        }
+        gen_cfg.profile = &mix;
+        break;
+
+      case 'D':
+        if (parse_hotset(optarg) == -1)
+        {
+          fprintf(stderr, "bad hot set \"%s\", expected lines[,pct[,true|false]]\n", optarg);
+          exit(1);
+        }
+        break;
+
       case 'h':
       default:
-        fprintf(stderr, "usage: encodeit [-h] [-s seed] [-n insts] [-t threads] [-l logfile]\n");
+        fprintf(stderr, "usage: encodeit [-h] [-s seed] [-n insts] [-t threads] [-l logfile] [-i iters]\n"
+                        "                [-c code_bytes] [-d data_bytes] [-H] [-p policy] [-C cpulist] [-B] [-G] [-U] [-P]\n"
+                        "                [-D lines[,pct[,true|false]]] [-M mix] [-V width] [-m workers]\n"
+                        "                [-T fork|pthread] [-b] [-w corpus] [-S start:count[:groups] -o results]\n"
+                        "                [-L sb|mp|lb|iriw[+mfence|+lock]] [-k count[,sync]]\n"
+                        "       encodeit -R [-i iters] [-p policy] [-C cpulist] corpus...\n");
         exit(1);
     }
   }
 
-  if (logfile)
-  {
-    fprintf(stderr, "redirecting output to logfile \"%s\"\n", logfile);
-    freopen(logfile, "w", stderr);
-  }
-
   // make the standard output and stderrr unbuffered
   setbuf(stdout, (char *) NULL);
   setbuf(stderr, (char *) NULL);
 
-  fprintf(stderr, "seed = %d, num insts = %d, num threads = %d\n", seed, num_inst, nthreads);
+  // -R: nothing is generated, the corpus files are run as they were saved
+  if (replay)
+  {
+    int bad = 0;
+
+    iterations = (iterations < 1) ? 1 : iterations;
+    quiet = 1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t_start);
+    for (i = optind; i < argc; i++)
+    {
+      bad += (replay_corpus(argv[i], placement, cpulist, &total_tests) != 0);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t_end);
+    elapsed = (t_end.tv_sec - t_start.tv_sec) + (t_end.tv_nsec - t_start.tv_nsec) / 1e9;
+
+    fprintf(stderr, "replayed %d corpus files (%d failed), %ld test cases in %.3f s: %.1f tests/s\n",
+            argc - optind, bad, total_tests, elapsed, elapsed > 0 ? total_tests / elapsed : 0.0);
+
+    return(bad != 0);
+  }
+
+  fprintf(stderr, "seed = %d, num insts = %d, num threads = %d, iterations = %d, %s\n",
+          seed, num_inst, nthreads, iterations, use_pthreads ? "pthreads" : "processes");
+
+  if (iterations < 1)
+  {
+    iterations = 1;
+  }
+
+  // per-iteration chatter would turn every test case into a pile of syscalls
+  quiet = (iterations > 1);
    
-  if (nthreads > MAX_THREADS) 
+  if (nthreads < 1)
+  {
+    nthreads = 1;
+  }
+
+  // -S: the same workers per seed, times the groups sharing out the seeds
+  if (camp_count)
   {
-    fprintf(stderr,"only built for %d threads overriding your %d\n", MAX_THREADS, nthreads);
-    nthreads = MAX_THREADS;
+    if (campaign_out == NULL)
+    {
+      fprintf(stderr, "a campaign needs a results file, -o\n");
+      exit(1);
+    }
+    if (min_workers || corpus_out || logfile || pipelined)
+    {
+      fprintf(stderr, "-m, -w, -l and -b don't apply to a campaign, rerun a seed on its own for those\n");
+      exit(1);
+    }
+
+    if (ngroups < 1)
+    {
+      ngroups = (topo_ncpus() < nthreads) ? 1 : topo_ncpus() / nthreads;
+    }
+    ngroups = (ngroups > camp_count) ? camp_count : ngroups;
+    quiet = 1;
+
+    fprintf(stderr, "campaign: seeds %d..%d on %d groups of %d\n",
+            camp_start, camp_start + camp_count - 1, ngroups, nthreads);
   }
+  nworkers = nthreads * ngroups;
 
-  srand(seed);
+  // -L: the test decides the threads and the data layout, there is no random body
+  if (use_litmus)
+  {
+    if (camp_count || min_workers || corpus_out || logfile || pipelined || gen_cfg.hot_lines || gen_cfg.profile ||
+        !gen_cfg.use_barrier || gen_cfg.loop_count)
+    {
+      fprintf(stderr, "-S, -m, -w, -l, -b, -D, -M, -B and -k don't apply to a litmus test\n");
+      exit(1);
+    }
 
-  // allocate buffer to perform stores and loads to
-  test_info[DATA].pointer_addr = mmap(
-    NULL,
-    (MAX_DATA_BYTES + PAGESIZE-1) * nthreads,
-    PROT_READ | PROT_WRITE | PROT_EXEC, MAP_ANONYMOUS | MAP_SHARED,
-    0, 0
-  );
+    if (nthreads != 1 && nthreads != litmus.test->nthreads)
+    {
+      fprintf(stderr, "litmus %s runs %d threads\n", litmus.test->name, litmus.test->nthreads);
+    }
+    nworkers = nthreads = litmus.test->nthreads;
+    data_bytes = litmus_data_bytes();
+    gen_cfg.shared_data = 1;
+    use_golden = 0;
+    quiet = 1;
+  }
 
-  // save the base address for debug like before 
-  mdptr = test_info[DATA].pointer_addr;
+  if (num_inst < 0)
+  {
+    num_inst = 0;
+  }
+
+  // code buffer must hold the worst case encoding of every instruction
+  if (instr_bytes < (long)num_inst * MAX_INSN_BYTES + FRAME_BYTES + SAFETY_MARGIN)
+  {
+    if (instr_bytes)
+    {
+      fprintf(stderr, "code buffer of %ld bytes too small for %d insts, resizing\n", instr_bytes, num_inst);
+    }
+    instr_bytes = (long)num_inst * MAX_INSN_BYTES + FRAME_BYTES + SAFETY_MARGIN;
+  }
+  instr_bytes = round_up(instr_bytes > DEF_INSTR_BYTES ? instr_bytes : DEF_INSTR_BYTES, PAGESIZE);
 
-  if (((int *)test_info[DATA].pointer_addr) == (int *)-1) 
+  // displacements are 32 bits, every byte of the data buffer must be reachable
+  if (data_bytes < PAGESIZE || data_bytes > INT_MAX)
   {
-    perror("Couldn't mmap (MAX_DATA_BYTES)");
+    fprintf(stderr, "data buffer must be between %d and %d bytes\n", PAGESIZE, INT_MAX);
     exit(1);
   }
+  data_bytes = round_up(data_bytes, PAGESIZE);
 
-  // allocate buffer to build instructions into
-  test_info[CODE].pointer_addr = mmap(
-    NULL,
-    (MAX_INSTR_BYTES + PAGESIZE-1) * nthreads,
-    PROT_READ | PROT_WRITE | PROT_EXEC,
-    MAP_ANONYMOUS | MAP_SHARED,
-    0, 0
-  );
+  gen_cfg.data_bytes = data_bytes;
+  gen_cfg.uniform = uniform;
+  gen_cfg.quiet = quiet;
 
-  // keep a copy to the base here
-  mptr = test_info[CODE].pointer_addr;
-  if (((int *)test_info[CODE].pointer_addr) == (int *)-1) 
+  // widest the CPU has unless -V asks for less
+  if (gen_vec_init(vec_width ? vec_width : VSZ_64) < vec_width)
+  {
+    fprintf(stderr, "CPU has no %d byte vectors, using %d\n", vec_width, gen_cfg.vec_width);
+  }
+
+  if (gen_cfg.profile)
+  {
+    profile_print(stderr, gen_cfg.profile);
+  }
+
+  // -D: one region for everybody, laid out as hot set + private slices
+  if (gen_cfg.hot_lines)
+  {
+    if (gen_shared_init(nthreads) == -1)
+    {
+      exit(1);
+    }
+
+    fprintf(stderr, "shared data: %d hot lines, %d%% of accesses, %s sharing, %ld private bytes/thread\n",
+            gen_cfg.hot_lines, gen_cfg.hot_pct, gen_cfg.false_sharing ? "false" : "true", gen_cfg.cold_bytes);
+
+    // the model assumes nobody else writes the buffer
+    if (use_golden && nthreads > 1)
+    {
+      fprintf(stderr, "shared data races, not checking against the golden model\n");
+      use_golden = 0;
+    }
+  }
+
+  code_total = instr_bytes * nworkers * (pipelined ? 2 : 1);
+  data_total = data_bytes * (gen_cfg.shared_data ? ngroups : nworkers);
+  if (huge_pages)
+  {
+    code_total = round_up(code_total, HUGE_PAGESIZE);
+    data_total = round_up(data_total, HUGE_PAGESIZE);
+  }
+
+  fprintf(stderr, "code bytes/thread = %ld, data bytes/thread = %ld%s\n",
+          instr_bytes, data_bytes, huge_pages ? ", huge pages" : "");
+
+  pid_task = calloc(nworkers, sizeof(int));
+  thread_status = calloc(nworkers, sizeof(int));
+  tid_task = calloc(nworkers, sizeof(pthread_t));
+  thread_cpu = calloc(nworkers, sizeof(int));
+  mptr_threads = calloc(nworkers, sizeof(volatile char *));
+  mdptr_threads = calloc(nworkers, sizeof(volatile char *));
+  if (!pid_task || !thread_status || !tid_task || !thread_cpu || !mptr_threads || !mdptr_threads)
+  {
+    perror("calloc");
+    exit(1);
+  }
+
+  // decide where every thread runs before anything is started
+  if (topo_place(placement, cpulist, nworkers, thread_cpu) == -1)
   {
-    perror("Couldn't mmap (MAX_INSTR_BYTES)");
     exit(1);
   }
 
+  if (camp_count)
+  {
+    campaign_hdr_t info = { 0 };
+    unsigned long settings[6] = { gen_cfg.hot_lines, gen_cfg.hot_pct, gen_cfg.false_sharing,
+                                  gen_cfg.profile ? sig_hash(gen_cfg.profile, sizeof(profile_t), 0) : 0,
+                                  gen_cfg.loop_count, gen_cfg.loop_barrier };
+
+    info.start = camp_start;
+    info.count = camp_count;
+    info.nthreads = nthreads;
+    info.iterations = iterations;
+    info.num_inst = num_inst;
+    info.data_bytes = data_bytes;
+    info.vec_width = gen_cfg.vec_width;
+    info.golden = use_golden;
+    info.uniform = uniform;
+    info.barrier = gen_cfg.use_barrier;
+    info.settings = sig_hash(settings, sizeof(settings), 0);
+
+    if (campaign_open(&camp, campaign_out, &info, ngroups) == -1)
+    {
+      exit(1);
+    }
+    if (camp.resumed)
+    {
+      fprintf(stderr, "resuming \"%s\": %ld of %d seeds already done\n", campaign_out, camp.resumed, camp_count);
+    }
+
+    // the workers inherit it, fork or not
+    campaign_catch_interrupt(&camp);
+  }
+
+  // allocate buffer to perform stores and loads to
+  test_info[DATA].pointer_addr = alloc_region(data_total, PROT_READ | PROT_WRITE, "data");
+
+  // save the base address for debug like before 
+  mdptr = test_info[DATA].pointer_addr;
+
+  // allocate buffer to build instructions into, written and run through separate views
+  test_info[CODE].pointer_addr = alloc_code_region(code_total, &mxptr);
+
+  // keep a copy to the base here
+  mptr = test_info[CODE].pointer_addr;
+
   // barrier_start semaphore
   barrier_start = mmap(
     NULL, sizeof(sem_t),
@@ -165,42 +692,108 @@ int main(int argc, char *argv[])
     exit(1);
   }
 
-  // start appropriate # of threads
-  for (i = 0; i < nthreads; i++) 
+  // shared comm area: the generated code's barriers and per-thread contexts,
+  // the results the children report back through and -S group state
+  comm_total = round_up((sizeof(barrier_t) + sizeof(camp_group_t)) * ngroups +
+                        (sizeof(thread_ctx_t) + sizeof(thread_result_t)) * nworkers, PAGESIZE);
+  comm_ptr = mmap(
+    NULL, comm_total,
+    PROT_READ | PROT_WRITE,
+    MAP_ANONYMOUS | MAP_SHARED,
+    -1, 0
+  );
+
+  if (comm_ptr == MAP_FAILED)
   {
-    next_ptr = (mptr + (i * MAX_INSTR_BYTES));                  // init next_ptr
-    fprintf(stderr, "T%d next_ptr = 0x%lx\n", i, (unsigned long)next_ptr);
-    mdptr_threads[i] = (tptrs)(mdptr + (i * MAX_DATA_BYTES));   // init threads data pointer
-    mptr_threads[i] = (tptrs)next_ptr;                          // save ptr per thread
+    perror("Couldn't mmap comm_ptr");
+    exit(1);
+  }
 
-    // use fork to start a new child process
-    if ((pid = fork()) == 0) 
+  barrier = (barrier_t *)comm_ptr;
+  thread_ctx = (thread_ctx_t *)(barrier + ngroups);
+  results = (thread_result_t *)(thread_ctx + nworkers);
+  groups = (camp_group_t *)(results + nworkers);
+
+  for (i = 0; i < nworkers; i++)
+  {
+    thread_ctx[i].barrier = &barrier[i / nthreads];
+    thread_ctx[i].nthreads = nthreads;
+  }
+
+  // per-thread binary event rings, rendered into the logfile at the end
+  if (logfile)
+  {
+    evlogs = mmap(
+      NULL, sizeof(evlog_t) * nthreads,
+      PROT_READ | PROT_WRITE,
+      MAP_ANONYMOUS | MAP_SHARED,
+      -1, 0
+    );
+
+    if (evlogs == MAP_FAILED)
     {
-      fprintf(stderr,"T%d started\n", i);
+      perror("Couldn't mmap event log");
+      exit(1);
+    }
+  }
 
-      cpu_set_t set;
-      CPU_ZERO(&set);
-      CPU_SET(i, &set);
+  // -m/-w: each thread's data as it was before its current test case
+  if (min_workers || corpus_out)
+  {
+    snapshots = mmap(
+      NULL, data_bytes * nthreads,
+      PROT_READ | PROT_WRITE,
+      MAP_ANONYMOUS | MAP_SHARED,
+      -1, 0
+    );
 
-      if (sched_setaffinity(0, sizeof(cpu_set_t), &set) == -1)
-      {
-        perror("sched_setaffinity");
-      }
+    if (snapshots == MAP_FAILED)
+    {
+      perror("Couldn't mmap snapshots");
+      exit(1);
+    }
+  }
+
+  // -L: every thread's part of the test, before anything can wait on it
+  for (i = 0; use_litmus && i < nworkers; i++)
+  {
+    if (litmus_build(&litmus, i, mptr + i * instr_bytes, instr_bytes) == NULL)
+    {
+      exit(1);
+    }
+  }
 
-      // wait to sync
-      sem_wait(barrier_start);
+  // start appropriate # of threads
+  for (i = 0; i < nworkers; i++) 
+  {
+    void *(*body)(void *) = camp_count ? run_campaign_worker : use_litmus ? run_litmus_worker : run_worker;
 
-      ibuilt = build_instructions(mptr_threads[i], i, num_inst);  
+    next_ptr = (mptr + (i * instr_bytes * (pipelined ? 2 : 1)));   // init next_ptr
+    if (!quiet)
+    {
+      fprintf(stderr, "T%d next_ptr = 0x%lx, cpu %d\n", i, (unsigned long)next_ptr, thread_cpu[i]);
+    }
+    mdptr_threads[i] = (tptrs)(mdptr + (gen_cfg.shared_data ? i / nthreads : i) * data_bytes);   // init threads data pointer
+    mptr_threads[i] = (tptrs)next_ptr;                          // save ptr per thread
 
-      // ok now that I built the critters, time to execute them 
-      start_test = (funct_t) mptr_threads[i];
-      executeit(start_test);
-      fprintf(stderr,"T%d generation program complete, instructions executed: %d\n",i, ibuilt);
+    if (use_pthreads)
+    {
+      // same worker, sharing this address space
+      if ((errno = pthread_create(&tid_task[i], NULL, body, (void *)(long)i)) != 0)
+      {
+        perror("pthread_create");
+        exit(1);
+      }
+    }
+    // use fork to start a new child process
+    else if ((pid = fork()) == 0) 
+    {
+      body((void *)(long)i);
 
       // children are finished
       exit(0);
     }
-    else if (pid_task[i] == -1) 
+    else if (pid == -1) 
     {
       perror("fork me failed");
       exit(1);
@@ -210,221 +803,1731 @@ int main(int argc, char *argv[])
       // this should be the parent 
       pid_task[i] = pid; // save pid
 
-      fprintf(stderr,"T%d PID = %d\n", i, pid);
+      if (!camp_count && !use_litmus)
+      {
+        fprintf(stderr,"T%d PID = %d\n", i, pid);
+      }
     }  
   } 
 
   fprintf(stderr,"--- parent at barrier_start --- \n");
 
-  // signal children to start
-  for (i = 0; i < nthreads; i++) 
+  clock_gettime(CLOCK_MONOTONIC, &t_start);
+
+  // signal the threads to start
+  for (i = 0; i < nworkers; i++) 
   {
     sem_post(barrier_start);
   }
 
-  // wait for threads to complete
-  for (i = 0; i < nthreads; i++) 
+  // wait for threads to complete, -m: note the first one that failed or died
+  for (i = 0; i < nworkers; i++) 
   {
-    waitpid(pid_task[i], NULL, 0);
+    if (use_pthreads)
+    {
+      pthread_join(tid_task[i], NULL);
+    }
+    else
+    {
+      waitpid(pid_task[i], &thread_status[i], 0);
+    }
+
+    if (min_workers && min_thread < 0 &&
+        (results[i].first_fail || !WIFEXITED(thread_status[i]) || WEXITSTATUS(thread_status[i])))
+    {
+      min_thread = i;
+    }
   }
 
-  // clean up the allocation before getting out
-  munmap((caddr_t)mdptr, (MAX_DATA_BYTES + PAGESIZE-1) * nthreads);
-  munmap((caddr_t)mptr, (MAX_INSTR_BYTES + PAGESIZE-1) * nthreads);
-  munmap((caddr_t)barrier_start, sizeof(sem_t));
+  clock_gettime(CLOCK_MONOTONIC, &t_end);
+  elapsed = (t_end.tv_sec - t_start.tv_sec) + (t_end.tv_nsec - t_start.tv_nsec) / 1e9;
 
-  return 0;
-}
+  // -S: the seeds' records are the results, this run's and any resumed
+  if (camp_count)
+  {
+    rc = report_campaign(elapsed);
+    campaign_close(&camp);
+  }
+  else if (use_litmus)
+  {
+    rc = litmus_report(stderr, &litmus, mdptr);
+    fprintf(stderr, "%ld iterations in %.3f s: %.1f iterations/s\n",
+            results[0].iterations, elapsed, elapsed > 0 ? results[0].iterations / elapsed : 0.0);
+  }
+  else
+  {
+    for (i = 0; i < nthreads; i++)
+    {
+      total_tests += results[i].iterations;
+      total_insts += results[i].insts;
+      total_fails += results[i].fails;
+      total_faults += results[i].faults;
+      perfctr_add(&total_perf, &results[i].perf, i == 0);
+    }
 
-/*
- * Function: executeit
- * 
- * Description:
- *    This function will start executing at the function address passed into it 
- *    and return an integer return value that will be used to indicate pass(0)/fail(1)
- *
- * Inputs:  
- *    funct_t start_addr :      function pointer 
- *
- * Output:  
- *    int                :      0 for pass, 1 for fail
- */
-int executeit(funct_t start_addr) 
-{
-  volatile int rc = 0;
+    fprintf(stderr, "%ld test cases (%ld failed, %ld faulted), %ld instructions in %.3f s: %.1f tests/s\n",
+            total_tests, total_fails, total_faults, total_insts, elapsed, elapsed > 0 ? total_tests / elapsed : 0.0);
 
-  rc = (*start_addr)();
-  return(0);
-}
+    if (total_faults)
+    {
+      report_faults();
+    }
 
-static inline volatile char *add_headeri(volatile char *tgt_addr)
-{
-  // setup stack
-  tgt_addr = build_enter(2048, tgt_addr);
-  
-  // save caller regs
-  tgt_addr = build_push_reg(REG_EBX, 0, tgt_addr);
-  tgt_addr = build_push_reg(REG_EBP, 0, tgt_addr);
-  tgt_addr = build_push_reg(REG_R12, 1, tgt_addr);
-  tgt_addr = build_push_reg(REG_R13, 1, tgt_addr);
-  tgt_addr = build_push_reg(REG_R14, 1, tgt_addr);
-  tgt_addr = build_push_reg(REG_R15, 1, tgt_addr);
-  
-  return(tgt_addr);
+    if (use_pmu)
+    {
+      for (i = 0; i < nthreads; i++)
+      {
+        char label[16];
+
+        snprintf(label, sizeof(label), "T%d", i);
+        perfctr_report(stderr, label, &results[i].perf, results[i].iterations);
+      }
+    }
+    perfctr_report(stderr, "total", &total_perf, total_tests);
+
+    if (report_signatures())
+    {
+      rc = 1;
+    }
+  }
+
+  // before -m, which rebuilds the failing test case in its thread's buffer
+  if (corpus_out)
+  {
+    write_corpus(corpus_out, placement, cpulist);
+  }
+
+  if (min_thread >= 0)
+  {
+    minimize_failure(min_thread, placement, cpulist);
+  }
+
+  if (logfile)
+  {
+    FILE *lf = fopen(logfile, "w");
+
+    if (lf == NULL)
+    {
+      perror(logfile);
+    }
+    else
+    {
+      fprintf(stderr, "writing event log to \"%s\"\n", logfile);
+      for (i = 0; i < nthreads; i++)
+      {
+        dump_event_log(lf, &evlogs[i], i);
+      }
+      fclose(lf);
+    }
+
+    munmap((caddr_t)evlogs, sizeof(evlog_t) * nthreads);
+  }
+
+  // clean up the allocation before getting out
+  munmap((caddr_t)mdptr, data_total);
+  munmap((caddr_t)mptr, code_total);
+  munmap((caddr_t)mxptr, code_total);
+  munmap((caddr_t)barrier_start, sizeof(sem_t));
+  munmap((caddr_t)comm_ptr, comm_total);
+  if (snapshots)
+  {
+    munmap((caddr_t)snapshots, data_bytes * nthreads);
+  }
+
+  free(pid_task);
+  free(thread_status);
+  free(tid_task);
+  free(thread_cpu);
+  free((void *)mptr_threads);
+  free((void *)mdptr_threads);
+
+  return rc;
+}
+
+/*
+ * Function: parse_size
+ *
+ * Description:
+ *    parse a byte count with an optional k/m/g suffix
+ */
+long parse_size(const char *arg)
+{
+  char *end;
+  long val = strtol(arg, &end, 0);
+
+  switch (*end)
+  {
+    case 'g': case 'G': val <<= 10; // FALL THROUGH
+    case 'm': case 'M': val <<= 10; // FALL THROUGH
+    case 'k': case 'K': val <<= 10;
+  }
+
+  return(val);
+}
+
+long round_up(long val, long align)
+{
+  return((val + align - 1) / align * align);
+}
+
+/*
+ * Function: parse_hotset
+ *
+ * Description:
+ *    parse -D lines[,pct[,true|false]] into gen_cfg, pct defaults to 50
+ *    and placement to true sharing
+ *
+ * Output:
+ *    0 on success, -1 on a malformed spec
+ */
+int parse_hotset(const char *arg)
+{
+  char *end;
+
+  gen_cfg.hot_lines = strtol(arg, &end, 0);
+  gen_cfg.hot_pct = 50;
+  gen_cfg.false_sharing = 0;
+
+  if (end == arg || gen_cfg.hot_lines < 1)
+  {
+    return(-1);
+  }
+
+  if (*end == ',')
+  {
+    arg = end + 1;
+    gen_cfg.hot_pct = strtol(arg, &end, 0);
+    if (end == arg)
+    {
+      return(-1);
+    }
+  }
+
+  if (*end == ',')
+  {
+    if (strcmp(end + 1, "false") == 0)
+    {
+      gen_cfg.false_sharing = 1;
+    }
+    else if (strcmp(end + 1, "true") != 0)
+    {
+      return(-1);
+    }
+  }
+  else if (*end)
+  {
+    return(-1);
+  }
+
+  return(0);
+}
+
+/*
+ * Function: parse_campaign
+ *
+ * Description:
+ *    parse -S start:count[:groups], groups defaults to what the CPUs allow
+ *
+ * Output:
+ *    0 on success, -1 on a malformed spec
+ */
+int parse_campaign(const char *arg)
+{
+  char *end;
+
+  camp_start = strtol(arg, &end, 0);
+  if (end == arg || *end != ':')
+  {
+    return(-1);
+  }
+
+  arg = end + 1;
+  camp_count = strtol(arg, &end, 0);
+  ngroups = 0;
+  if (end == arg || camp_count < 1 || (long)camp_start + camp_count - 1 > INT_MAX)
+  {
+    return(-1);
+  }
+
+  if (*end == ':')
+  {
+    arg = end + 1;
+    ngroups = strtol(arg, &end, 0);
+    if (end == arg || ngroups < 1)
+    {
+      return(-1);
+    }
+  }
+
+  return(*end ? -1 : 0);
+}
+
+/*
+ * Function: parse_loop
+ *
+ * Description:
+ *    parse -k count[,sync] into gen_cfg: run every body count times
+ *    before returning, with a barrier at the top of every iteration if
+ *    sync is given
+ *
+ * Output:
+ *    0 on success, -1 on a malformed spec
+ */
+int parse_loop(const char *arg)
+{
+  char *end;
+  long count = strtol(arg, &end, 0);
+
+  if (end == arg || count < 1 || count > INT_MAX)
+  {
+    return(-1);
+  }
+
+  gen_cfg.loop_count = count;
+  gen_cfg.loop_barrier = 0;
+  if (*end == ',')
+  {
+    if (strcmp(end + 1, "sync") != 0)
+    {
+      return(-1);
+    }
+    gen_cfg.loop_barrier = 1;
+  }
+  else if (*end)
+  {
+    return(-1);
+  }
+
+  return(0);
+}
+
+/*
+ * Function: alloc_region
+ *
+ * Description:
+ *    shared anonymous mapping for the code/data regions.  With -H try a
+ *    hugetlbfs backed mapping first, and fall back to asking for
+ *    transparent huge pages on a regular one.
+ *
+ * Inputs:
+ *    long size                :  bytes, huge page multiple when -H
+ *    int prot                 :  mmap protection
+ *    const char *what         :  region name for messages
+ *
+ * Output:
+ *    base address, exits on failure
+ */
+volatile char *alloc_region(long size, int prot, const char *what)
+{
+  void *p = MAP_FAILED;
+
+  if (huge_pages)
+  {
+    p = mmap(NULL, size, prot, MAP_ANONYMOUS | MAP_SHARED | MAP_HUGETLB, -1, 0);
+    if (p == MAP_FAILED)
+    {
+      fprintf(stderr, "no hugetlb pages for %s region, falling back to THP\n", what);
+    }
+  }
+
+  if (p == MAP_FAILED)
+  {
+    p = mmap(NULL, size, prot, MAP_ANONYMOUS | MAP_SHARED, -1, 0);
+    if (p == MAP_FAILED)
+    {
+      fprintf(stderr, "Couldn't mmap %s region (%ld bytes): ", what, size);
+      perror("");
+      exit(1);
+    }
+
+    if (huge_pages && madvise(p, size, MADV_HUGEPAGE) == -1)
+    {
+      perror("madvise(MADV_HUGEPAGE)");
+    }
+  }
+
+  return((volatile char *)p);
+}
+
+/*
+ * Function: run_generator
+ *
+ * Description:
+ *    -b: builds a worker's test cases into its two code slots, one
+ *    iteration ahead of the worker running them.  A slot is written only
+ *    while its full flag is clear and published with a release store.
+ *
+ * Inputs:
+ *    void *arg                :  the worker's pipeline_t
+ *
+ * Output:
+ *    NULL
+ */
+void *run_generator(void *arg)
+{
+  pipeline_t *pl = arg;
+  int i = pl->thread_id;
+
+  for (int iter = 0; iter < iterations; iter++)
+  {
+    code_slot_t *cs = &pl->slot[iter & 1];
+    rng_t rng;
+
+    if (slot_wait(&cs->full, 0, &pl->stop) == -1)
+    {
+      break;
+    }
+
+    // the same stream the sequential worker would draw from
+    rng_seed(&rng, seed, uniform ? 0 : i, iter);
+    cs->built = build_instructions(cs->code, instr_bytes, i, num_inst, &rng, &cs->ir);
+
+    __atomic_store_n(&cs->full, 1, __ATOMIC_RELEASE);
+  }
+
+  return(NULL);
+}
+
+/*
+ * Function: run_worker
+ *
+ * Description:
+ *    body of one test thread: pins itself, waits at barrier_start, then
+ *    generates, runs and checks a test case per iteration.  Runs in a
+ *    forked child or, with -T pthread, a thread of the parent.
+ *
+ * Inputs:
+ *    void *arg                :  logical thread id
+ *
+ * Output:
+ *    NULL
+ */
+void *run_worker(void *arg)
+{
+  int i = (int)(long)arg;
+  int ibuilt, rc;
+  funct_t start_test;
+  pipeline_t *pl = NULL;
+  pthread_t gen_tid;
+  insn_ir_t own_ir, *ir = &own_ir;
+  volatile char *code = mptr_threads[i];
+
+  fprintf(stderr,"T%d started\n", i);
+
+  // -b: the generator is started before pinning so it can run beside us
+  if (pipelined)
+  {
+    if ((pl = calloc(1, sizeof(pipeline_t))) == NULL ||
+        ir_alloc(&pl->slot[0].ir, num_inst) == -1 || ir_alloc(&pl->slot[1].ir, num_inst) == -1)
+    {
+      perror("pipeline alloc");
+      exit(1);
+    }
+    pl->thread_id = i;
+    pl->slot[0].code = mptr_threads[i];
+    pl->slot[1].code = mptr_threads[i] + instr_bytes;
+
+    if ((errno = pthread_create(&gen_tid, NULL, run_generator, pl)) != 0)
+    {
+      perror("pthread_create generator");
+      exit(1);
+    }
+  }
+  else if (ir_alloc(&own_ir, num_inst) == -1)
+  {
+    perror("ir_alloc");
+    exit(1);
+  }
+
+  results[i].cpu = pin_worker(i, thread_cpu[i]);
+
+  if (fault_init_thread() == -1)
+  {
+    exit(1);
+  }
+
+  golden_t golden = { 0 };
+  perfctr_t pc;
+
+  // counters follow this process to whatever it runs, open them pinned
+  if (perfctr_open(&pc, use_pmu) && !quiet)
+  {
+    fprintf(stderr, "T%d counting %d hardware events\n", i, pc.nopen);
+  }
+
+  // wait to sync
+  sem_wait(barrier_start);
+
+  // persistent worker: a fresh test case per iteration in the same buffer
+  for (int iter = 0; iter < iterations; iter++)
+  {
+    code_slot_t *cs = NULL;
+
+    if (pl)
+    {
+      // the generator built this one while the last one ran
+      cs = &pl->slot[iter & 1];
+      slot_wait(&cs->full, 1, NULL);
+      serialize();
+      ir = &cs->ir;
+      code = cs->code;
+      ibuilt = cs->built;
+    }
+    else
+    {
+      rng_t rng;
+
+      // independent, reproducible stream per (seed, thread, iteration)
+      rng_seed(&rng, seed, uniform ? 0 : i, iter);
+      ibuilt = build_instructions(code, instr_bytes, i, num_inst, &rng, ir);
+    }
+
+    if (evlogs)
+    {
+      log_instructions(&evlogs[i], ir, iter);
+      evlog_event(&evlogs[i], EV_EXEC_BEGIN, iter, 0);
+    }
+
+    // ok now that I built the critters, time to execute them through the RX view
+    start_test = (funct_t)(mxptr + (code - mptr));
+    if (snapshots)
+    {
+      memcpy((void *)(snapshots + i * data_bytes), (void *)mdptr_threads[i], data_bytes);
+    }
+    rc = run_test_case(i, start_test, ir, &golden, &pc, iter);
+
+    results[i].last_sig = test_signature(mdptr_threads[i], &thread_ctx[i]);
+    results[i].sig = sig_chain(results[i].sig, results[i].last_sig);
+
+    if (evlogs)
+    {
+      evlog_event(&evlogs[i], EV_EXEC_END, iter, rc);
+      evlog_event(&evlogs[i], EV_SIGNATURE, iter, results[i].last_sig);
+    }
+
+    results[i].insts += ibuilt;
+    results[i].iterations++;
+
+    // keep the failing state for the minimizer
+    if (rc && min_workers)
+    {
+      results[i].first_fail = iter + 1;
+      break;
+    }
+
+    // done with the buffer, the generator may refill it
+    if (cs)
+    {
+      __atomic_store_n(&cs->full, 0, __ATOMIC_RELEASE);
+    }
+  }
+
+  fprintf(stderr,"T%d generation program complete, test cases executed: %ld\n",
+          i, results[i].iterations);
+
+  if (pl)
+  {
+    pl->stop = 1;
+    pthread_join(gen_tid, NULL);
+    ir_free(&pl->slot[0].ir);
+    ir_free(&pl->slot[1].ir);
+    free(pl);
+  }
+  else
+  {
+    ir_free(&own_ir);
+  }
+  golden_free(&golden);
+  perfctr_close(&pc);
+  return(NULL);
+}
+
+/*
+ * Function: run_test_case
+ *
+ * Description:
+ *    runs a built test case on thread i's data and context, checks it
+ *    against the golden model where that applies and counts a failure or
+ *    fault into the thread's results
+ *
+ * Inputs:
+ *    int i                    :  worker
+ *    funct_t test             :  entry point, through the RX view
+ *    insn_ir_t *ir            :  the test case
+ *    golden_t *golden         :  the worker's model state
+ *    perfctr_t *pc            :  the worker's counters
+ *    long iter                :  test case number, for the fault report
+ *
+ * Output:
+ *    EXEC_PASS, EXEC_MISMATCH or EXEC_FAULT
+ */
+int run_test_case(int i, funct_t test, insn_ir_t *ir, golden_t *golden, perfctr_t *pc, long iter)
+{
+  int rc, checked;
+
+  checked = use_golden ? golden_prepare(golden, ir, mdptr_threads[i], data_bytes) : GOLDEN_UNCHECKED;
+  if (checked == -1)
+  {
+    perror("golden_prepare");
+    exit(1);
+  }
+
+  rc = executeit(test, mdptr_threads[i], &thread_ctx[i], (checked == 0) ? golden : NULL,
+                 pc, &results[i].perf, i);
+  if (rc)
+  {
+    results[i].fails++;
+  }
+  if (rc == EXEC_FAULT)
+  {
+    record_fault(i, iter, test, ir);
+  }
+
+  return(rc);
+}
+
+/*
+ * Function: run_campaign_worker
+ *
+ * Description:
+ *    -S: body of one worker of a group.  Worker 0 of the group takes the
+ *    next seed, every worker zeroes the data it owns, and after a group
+ *    barrier they all run the seed's test cases the way run_worker() does
+ *    for -s, as thread (worker % nthreads).  After a second barrier
+ *    worker 0 folds the group's results into the seed's record.
+ *
+ * Inputs:
+ *    void *arg                :  worker, nthreads * group + thread
+ *
+ * Output:
+ *    NULL
+ */
+void *run_campaign_worker(void *arg)
+{
+  int i = (int)(long)arg;
+  int g = i / nthreads, t = i % nthreads;
+  int owns_data = !gen_cfg.shared_data || t == 0;
+  camp_group_t *grp = &groups[g];
+  volatile char *code = mptr_threads[i];
+  funct_t test = (funct_t)(mxptr + (code - mptr));
+  thread_ctx_t between = { 0 };
+  golden_t golden = { 0 };
+  perfctr_t pc;
+  insn_ir_t ir;
+  int s;
+
+  between.barrier = &grp->sync;
+  between.nthreads = nthreads;
+
+  if (ir_alloc(&ir, num_inst) == -1)
+  {
+    perror("ir_alloc");
+    exit(1);
+  }
+
+  results[i].cpu = pin_worker(i, thread_cpu[i]);
+  if (fault_init_thread() == -1)
+  {
+    exit(1);
+  }
+  perfctr_open(&pc, use_pmu);
+
+  sem_wait(barrier_start);
+
+  for (;;)
+  {
+    // the last seed's state is hashed, nobody is running: start over from zeroed data
+    if (t == 0)
+    {
+      grp->seed = campaign_next(&camp, g);
+    }
+    if (owns_data)
+    {
+      memset((void *)mdptr_threads[i], 0, data_bytes);
+    }
+    barrier_arrive(&between);
+
+    if ((s = grp->seed) < 0)
+    {
+      break;
+    }
+
+    // worker 0 read the last seed's results before it let us in here
+    memset((void *)&results[i], 0, sizeof(results[i]));
+
+    for (int iter = 0; iter < iterations; iter++)
+    {
+      rng_t rng;
+
+      rng_seed(&rng, s, uniform ? 0 : t, iter);
+      results[i].insts += build_instructions(code, instr_bytes, t, num_inst, &rng, &ir);
+
+      run_test_case(i, test, &ir, &golden, &pc, iter);
+
+      results[i].last_sig = test_signature(mdptr_threads[i], &thread_ctx[i]);
+      results[i].sig = sig_chain(results[i].sig, results[i].last_sig);
+      results[i].iterations++;
+    }
+
+    barrier_arrive(&between);
+    if (t == 0)
+    {
+      commit_seed(g, s);
+    }
+  }
+
+  ir_free(&ir);
+  golden_free(&golden);
+  perfctr_close(&pc);
+  return(NULL);
+}
+
+/*
+ * Function: run_litmus_worker
+ *
+ * Description:
+ *    -L: body of one thread of a litmus test.  The code main() built loops
+ *    up to LIT_RING iterations per call with no way out to C or the
+ *    kernel; between calls thread 0 tallies the outcomes and sets the
+ *    next call's count, the last call runs what's left of -i.
+ *
+ * Inputs:
+ *    void *arg                :  logical thread id
+ *
+ * Output:
+ *    NULL
+ */
+void *run_litmus_worker(void *arg)
+{
+  int i = (int)(long)arg;
+  funct_t test = (funct_t)(mxptr + (mptr_threads[i] - mptr));
+  long calls = (iterations + LIT_RING - 1) / LIT_RING;
+
+  results[i].cpu = pin_worker(i, thread_cpu[i]);
+  sem_wait(barrier_start);
+
+  for (long c = 0; c < calls; c++)
+  {
+    // read by every thread after the start barrier, which thread 0 hasn't reached yet
+    if (i == 0)
+    {
+      litmus_set_count(mdptr_threads[i], (c < calls - 1) ? LIT_RING : iterations - c * LIT_RING);
+    }
+
+    (*test)(mdptr_threads[i], &thread_ctx[i]);
+
+    // the others are held at the next call's start barrier until this is done
+    if (i == 0)
+    {
+      litmus_tally(&litmus, mdptr_threads[i]);
+    }
+  }
+
+  results[i].iterations = iterations;
+  return(NULL);
+}
+
+/*
+ * Function: commit_seed
+ *
+ * Description:
+ *    folds the results of group g's workers for seed s into its record
+ *    and publishes it
+ */
+void commit_seed(int g, int s)
+{
+  thread_result_t *r = &results[g * nthreads];
+  campaign_rec_t rec = { 0 };
+  perfctr_counts_t perf = { 0 };
+
+  rec.seed = s;
+  rec.sig = r[0].sig;
+  for (int t = 0; t < nthreads; t++)
+  {
+    rec.fails += r[t].fails;
+    rec.faults += r[t].faults;
+    perfctr_add(&perf, &r[t].perf, t == 0);
+
+    // not sig_chain(): equal -U signatures would cancel out
+    if (t > 0)
+    {
+      rec.sig = sig_hash(&r[t].sig, sizeof(r[t].sig), rec.sig);
+    }
+    // as report_signatures(): -U threads all ran thread 0's test cases
+    if (uniform && !gen_cfg.shared_data && r[t].sig != r[0].sig)
+    {
+      rec.flags |= CAMP_DIVERGED;
+    }
+  }
+
+  rec.flags |= (rec.fails ? CAMP_FAILED : 0) | (rec.faults ? CAMP_FAULTED : 0);
+  rec.tsc = perf.tsc;
+  rec.valid = perf.valid;
+  memcpy(rec.count, perf.count, sizeof(rec.count));
+
+  campaign_commit(&camp, g, &rec);
+}
+
+/*
+ * Function: report_campaign
+ *
+ * Description:
+ *    -S summary over every seed with a record, resumed ones included,
+ *    and the first seeds that failed or diverged
+ *
+ * Inputs:
+ *    double elapsed           :  wall time of this run
+ *
+ * Output:
+ *    1 if a seed failed or diverged or the campaign is unfinished, else 0
+ */
+int report_campaign(double elapsed)
+{
+  perfctr_counts_t perf = { 0 };
+  long done = 0, failed = 0, faulted = 0, diverged = 0, ran;
+  int shown = 0;
+
+  for (int k = 0; k < camp_count; k++)
+  {
+    campaign_rec_t *r = &camp.rec[k];
+    perfctr_counts_t c = { 0 };
+
+    if (!(r->flags & CAMP_DONE))
+    {
+      continue;
+    }
+
+    c.tsc = r->tsc;
+    c.valid = r->valid;
+    memcpy(c.count, r->count, sizeof(c.count));
+    perfctr_add(&perf, &c, done == 0);
+    done++;
+
+    failed += (r->flags & CAMP_FAILED) != 0;
+    faulted += (r->flags & CAMP_FAULTED) != 0;
+    diverged += (r->flags & CAMP_DIVERGED) != 0;
+
+    if ((r->flags & (CAMP_FAILED | CAMP_DIVERGED)) && shown++ < CAMP_SHOW)
+    {
+      fprintf(stderr, "seed %d: %d failed, %d faulted, signature 0x%016lx%s\n",
+              r->seed, r->fails, r->faults, r->sig, (r->flags & CAMP_DIVERGED) ? ", threads diverged" : "");
+    }
+  }
+
+  ran = done - camp.resumed;
+  fprintf(stderr, "campaign: %ld of %d seeds done (%ld resumed), %ld failed, %ld faulted, %ld diverged\n",
+          done, camp_count, camp.resumed, failed, faulted, diverged);
+  fprintf(stderr, "%ld seeds, %ld test cases in %.3f s: %.1f seeds/s, %.1f tests/s\n",
+          ran, ran * nthreads * iterations, elapsed, elapsed > 0 ? ran / elapsed : 0.0,
+          elapsed > 0 ? ran * nthreads * iterations / elapsed : 0.0);
+  perfctr_report(stderr, "total", &perf, done * nthreads * iterations);
+
+  if (done < camp_count)
+  {
+    fprintf(stderr, "campaign stopped early, rerun it with -o %s to resume\n", campaign_out);
+  }
+
+  return(failed || diverged || done < camp_count);
+}
+
+/*
+ * Function: minimize_failure
+ *
+ * Description:
+ *    -m: regenerates a thread's failing test case from its (seed, thread,
+ *    iteration) stream, shrinks it against the data snapshot taken before
+ *    it ran and prints the reproducer in event log form
+ *
+ * Inputs:
+ *    int thread_id            :  thread that failed
+ *    const char *placement    :  -p policy for the minimizer's workers
+ *    const char *cpulist      :  -C list for the minimizer's workers
+ */
+void minimize_failure(int thread_id, const char *placement, const char *cpulist)
+{
+  static minimizer_t m;
+  int cpus[MIN_MAX_WORKERS];
+  int status = thread_status[thread_id];
+  long iter = last_test_case(thread_id);
+  int fail, original;
+  insn_ir_t ir;
+  rng_t rng;
+  char what[64];
+
+  if (WIFSIGNALED(status))
+  {
+    fprintf(stderr, "T%d killed by signal %d in test case %ld\n", thread_id, WTERMSIG(status), iter);
+  }
+
+  if (topo_place(placement, cpulist, min_workers, cpus) == -1 || ir_alloc(&ir, num_inst) == -1)
+  {
+    fprintf(stderr, "minimizer setup failed\n");
+    return;
+  }
+
+  if (minimize_init(&m, cpus, min_workers, (const unsigned char *)(snapshots + thread_id * data_bytes),
+                    data_bytes, instr_bytes, use_golden, num_inst) == -1)
+  {
+    perror("minimize_init");
+    ir_free(&ir);
+    return;
+  }
+
+  // the same stream the worker drew the test case from
+  rng_seed(&rng, seed, uniform ? 0 : thread_id, iter);
+  build_instructions(mptr_threads[thread_id], instr_bytes, thread_id, num_inst, &rng, &ir);
+  original = ir.count;
+
+  fprintf(stderr, "T%d minimizing test case %ld, %d instructions, %d workers\n", thread_id, iter, original, m.workers);
+
+  fail = minimize(&m, &ir);
+  if (fail == MIN_PASS || fail == MIN_ERROR)
+  {
+    fprintf(stderr, "T%d test case %ld doesn't fail when rerun on its own (%s), nothing to minimize\n",
+            thread_id, iter, minimize_describe(fail, what, sizeof(what)));
+    if (fail == MIN_PASS && nthreads > 1)
+    {
+      fprintf(stderr, "only single-thread failures can be minimized: candidates run T%d alone, without the other %d threads\n",
+              thread_id, nthreads - 1);
+    }
+  }
+  else
+  {
+    evlog_t *log = calloc(1, sizeof(evlog_t));
+
+    fprintf(stderr, "T%d test case %ld: %s, minimized from %d to %d instructions in %ld runs\n",
+            thread_id, iter, minimize_describe(fail, what, sizeof(what)), original, ir.count, m.runs);
+
+    // code offsets of the reproducer as it encodes on its own
+    encode_test(mptr_threads[thread_id], instr_bytes, &ir);
+    if (log)
+    {
+      log_instructions(log, &ir, iter);
+      dump_event_log(stderr, log, thread_id);
+      free(log);
+    }
+  }
+
+  minimize_free(&m);
+  ir_free(&ir);
+}
+
+/*
+ * Function: last_test_case
+ *
+ * Description:
+ *    the test case a thread ran last: the one -m stopped it on, the one
+ *    it died in, or else its final iteration
+ */
+long last_test_case(int thread_id)
+{
+  int status = thread_status[thread_id];
+
+  if (results[thread_id].first_fail)
+  {
+    return(results[thread_id].first_fail - 1);
+  }
+
+  return((WIFEXITED(status) && WEXITSTATUS(status) == 0) ? results[thread_id].iterations - 1 : results[thread_id].iterations);
+}
+
+/*
+ * Function: write_corpus
+ *
+ * Description:
+ *    -w: rebuilds every thread's last test case from its (seed, thread,
+ *    iteration) stream and saves it with the data snapshot taken before
+ *    it ran.  Signatures are saved only where a rerun can match them:
+ *    -U (no rsp or buffer addresses in the results), private data or a
+ *    single thread, and a test case that ran to the end.
+ *
+ * Inputs:
+ *    const char *path         :  corpus file to write
+ *    const char *placement    :  -p policy, recorded
+ *    const char *cpulist      :  -C list, recorded
+ */
+void write_corpus(const char *path, const char *placement, const char *cpulist)
+{
+  corpus_hdr_t info = { 0 };
+  corpus_test_t *tests = calloc(nthreads, sizeof(corpus_test_t));
+  insn_ir_t *irs = calloc(nthreads, sizeof(insn_ir_t));
+  int reproducible = uniform && (!gen_cfg.shared_data || nthreads == 1);
+  int i;
+
+  if (tests == NULL || irs == NULL)
+  {
+    perror("write_corpus");
+    free(tests);
+    free(irs);
+    return;
+  }
+
+  info.nthreads = nthreads;
+  info.seed = seed;
+  info.vec_width = gen_cfg.vec_width;
+  info.code_bytes = instr_bytes;
+  info.data_bytes = data_bytes;
+  info.shared_data = gen_cfg.shared_data;
+  info.golden = use_golden;
+  info.barrier = gen_cfg.use_barrier;
+  info.loop_barrier = gen_cfg.loop_barrier;
+  snprintf(info.placement, sizeof(info.placement), "%s", cpulist ? cpulist : placement ? placement : "linear");
+
+  for (i = 0; i < nthreads; i++)
+  {
+    long iter = last_test_case(i);
+    int clean = WIFEXITED(thread_status[i]) && WEXITSTATUS(thread_status[i]) == 0;
+    rng_t rng;
+
+    if (ir_alloc(&irs[i], num_inst) == -1)
+    {
+      perror("ir_alloc");
+      break;
+    }
+
+    // the same stream the worker drew the test case from
+    rng_seed(&rng, seed, uniform ? 0 : i, iter);
+    build_instructions(mptr_threads[i], instr_bytes, i, num_inst, &rng, &irs[i]);
+
+    tests[i].ir = &irs[i];
+    tests[i].code = mptr_threads[i];
+    tests[i].data = snapshots + (gen_cfg.shared_data ? 0 : i) * data_bytes;
+    tests[i].cpu = thread_cpu[i];
+    tests[i].iteration = iter;
+    tests[i].sig = (reproducible && clean) ? results[i].last_sig : 0;
+  }
+
+  if (i == nthreads && corpus_write(path, &info, tests) == 0)
+  {
+    fprintf(stderr, "wrote corpus \"%s\": %d threads, test cases", path, nthreads);
+    for (i = 0; i < nthreads; i++)
+    {
+      fprintf(stderr, " %d", tests[i].iteration);
+    }
+    fprintf(stderr, "%s\n", reproducible ? "" : ", no signatures");
+  }
+
+  for (i = 0; i < nthreads; i++)
+  {
+    if (irs[i].imm)
+    {
+      ir_free(&irs[i]);
+    }
+  }
+  free(tests);
+  free(irs);
+}
+
+// one replay thread's view of the corpus and what it saw
+typedef struct
+{
+  const corpus_t *c;
+  int t;
+  int cpu;
+  volatile char *data;
+  thread_ctx_t *ctx;
+  pthread_barrier_t *sync;
+  long runs;
+  long fails;                 // golden mismatches and faults
+  long faults;
+  long sig_fails;             // signature differs from the saved one
+} replay_arg_t;
+
+/*
+ * Function: replay_thread
+ *
+ * Description:
+ *    runs one thread of a corpus iterations times.  Every run starts from
+ *    the saved data image; the threads meet before and after the reset so
+ *    no run sees another's half restored buffer.
+ */
+void *replay_thread(void *arg)
+{
+  replay_arg_t *ra = arg;
+  const corpus_hdr_t *hdr = ra->c->hdr;
+  const corpus_thread_t *ct = &hdr->thread[ra->t];
+  funct_t test = (funct_t)corpus_code(ra->c, ra->t);
+  int resets = !hdr->shared_data || ra->t == 0;
+  insn_ir_t ir;
+  golden_t golden = { 0 };
+  perfctr_t pc;
+  perfctr_counts_t counts = { 0 };
+  int rc, checked;
+
+  corpus_ir(ra->c, ra->t, &ir);
+  pin_worker(ra->t, ra->cpu);
+  perfctr_open(&pc, 0);
+  if (fault_init_thread() == -1)
+  {
+    exit(1);
+  }
+
+  for (int rep = 0; rep < iterations; rep++)
+  {
+    pthread_barrier_wait(ra->sync);
+    if (resets)
+    {
+      memcpy((void *)ra->data, (const void *)corpus_data(ra->c, ra->t), hdr->data_bytes);
+    }
+    pthread_barrier_wait(ra->sync);
+
+    checked = hdr->golden ? golden_prepare(&golden, &ir, ra->data, hdr->data_bytes) : GOLDEN_UNCHECKED;
+    if (checked == -1)
+    {
+      perror("golden_prepare");
+      exit(1);
+    }
+
+    rc = executeit(test, ra->data, ra->ctx, (checked == 0) ? &golden : NULL, &pc, &counts, ra->t);
+    ra->fails += (rc != EXEC_PASS);
+    ra->faults += (rc == EXEC_FAULT);
+    ra->sig_fails += (ct->sig && test_signature(ra->data, ra->ctx) != ct->sig);
+    ra->runs++;
+  }
+
+  golden_free(&golden);
+  perfctr_close(&pc);
+
+  return(NULL);
 }
 
-static inline volatile char *add_endi(volatile char *tgt_addr)
+/*
+ * Function: replay_corpus
+ *
+ * Description:
+ *    -R: maps a corpus file and runs its test case on one pthread per
+ *    saved thread, straight from the mapping
+ *
+ * Inputs:
+ *    const char *path         :  corpus file
+ *    const char *placement    :  -p policy, overrides the saved CPUs
+ *    const char *cpulist      :  -C list, overrides the saved CPUs
+ *    long *runs               :  test cases run are added here
+ *
+ * Output:
+ *    0 if every run passed, 1 on a mismatch, -1 if it couldn't be run
+ */
+int replay_corpus(const char *path, const char *placement, const char *cpulist, long *runs)
 {
-  // restore regs
-  tgt_addr = build_pop_reg(REG_R15, 1, tgt_addr);
-  tgt_addr = build_pop_reg(REG_R14, 1, tgt_addr);
-  tgt_addr = build_pop_reg(REG_R13, 1, tgt_addr);
-  tgt_addr = build_pop_reg(REG_R12, 1, tgt_addr);
-  tgt_addr = build_pop_reg(REG_EBP, 0, tgt_addr);
-  tgt_addr = build_pop_reg(REG_EBX, 0, tgt_addr);
-  
-  // break down stack
-  tgt_addr = build_leave(tgt_addr);
-  tgt_addr = build_return(tgt_addr);
-  
-  return(tgt_addr);
+  corpus_t c;
+  const corpus_hdr_t *hdr;
+  int n, images, rc = -1;
+  int *cpus = NULL;
+  long fails = 0, faults = 0, sig_fails = 0, comm_len;
+  char *comm = MAP_FAILED;
+  volatile char *data = MAP_FAILED;
+  pthread_t *tids = NULL;
+  replay_arg_t *args = NULL;
+  pthread_barrier_t sync;
+
+  if (corpus_open(&c, path) == -1)
+  {
+    return(-1);
+  }
+  hdr = c.hdr;
+  n = hdr->nthreads;
+  images = hdr->shared_data ? 1 : n;
+
+  if (gen_vec_init(VSZ_64) < hdr->vec_width)
+  {
+    fprintf(stderr, "%s: needs %d byte vectors, skipped\n", path, hdr->vec_width);
+    corpus_close(&c);
+    return(-1);
+  }
+
+  // test_signature() hashes a buffer this size, executeit() pays barriers a fault skips
+  data_bytes = hdr->data_bytes;
+  gen_cfg.use_barrier = hdr->barrier;
+  gen_cfg.loop_barrier = hdr->loop_barrier;
+  gen_cfg.loop_count = hdr->thread[0].loops;
+
+  comm_len = round_up(sizeof(barrier_t) + sizeof(thread_ctx_t) * n, PAGESIZE);
+  cpus = calloc(n, sizeof(int));
+  tids = calloc(n, sizeof(pthread_t));
+  args = calloc(n, sizeof(replay_arg_t));
+  comm = mmap(NULL, comm_len, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+  data = mmap(NULL, hdr->data_bytes * images, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+  if (!cpus || !tids || !args || comm == MAP_FAILED || data == MAP_FAILED)
+  {
+    perror("replay");
+  }
+  else if ((placement || cpulist) && topo_place(placement, cpulist, n, cpus) == -1)
+  {
+    fprintf(stderr, "%s: not replayed\n", path);
+  }
+  else
+  {
+    pthread_barrier_init(&sync, NULL, n);
+    for (int t = 0; t < n; t++)
+    {
+      thread_ctx_t *ctx = (thread_ctx_t *)(comm + sizeof(barrier_t)) + t;
+
+      // saved CPUs unless told otherwise
+      if (!placement && !cpulist)
+      {
+        cpus[t] = hdr->thread[t].cpu;
+      }
+
+      ctx->barrier = (barrier_t *)comm;
+      ctx->nthreads = n;
+
+      args[t] = (replay_arg_t){ .c = &c, .t = t, .cpu = cpus[t], .ctx = ctx, .sync = &sync,
+                                .data = data + (hdr->shared_data ? 0 : t) * hdr->data_bytes };
+      if ((errno = pthread_create(&tids[t], NULL, replay_thread, &args[t])) != 0)
+      {
+        perror("pthread_create");
+        exit(1);
+      }
+    }
+
+    for (int t = 0; t < n; t++)
+    {
+      pthread_join(tids[t], NULL);
+      *runs += args[t].runs;
+      fails += args[t].fails;
+      faults += args[t].faults;
+      sig_fails += args[t].sig_fails;
+    }
+    pthread_barrier_destroy(&sync);
+
+    fprintf(stderr, "%s: seed %d, %d threads (%s), %ld failed (%ld faulted), %ld signature mismatches\n",
+            path, hdr->seed, n, hdr->placement, fails, faults, sig_fails);
+    rc = (fails || sig_fails);
+  }
+
+  if (comm != MAP_FAILED)
+  {
+    munmap(comm, comm_len);
+  }
+  if (data != MAP_FAILED)
+  {
+    munmap((caddr_t)data, hdr->data_bytes * images);
+  }
+  free(cpus);
+  free(tids);
+  free(args);
+  corpus_close(&c);
+
+  return(rc);
 }
 
 /*
- * Function: build_instructions
+ * Function: alloc_code_region
  *
  * Description:
- *    builds pop register
+ *    the code region is a memfd mapped twice, writable for the generator
+ *    and executable for the workers, so no page is ever W and X at once.
+ *    With -H the memfd comes from hugetlbfs if it can; a hugetlb memfd is
+ *    created even with no huge pages reserved and only fails to map, so
+ *    the fallback to a regular memfd asking for THP happens at the mmap,
+ *    as alloc_region() does for the data region.
  *
- * Inputs: 
- *    int reg_index         :  index of register     // TO DO
+ * Inputs:
+ *    long size                :  bytes, huge page multiple when -H
+ *    volatile char **rx       :  returns the base of the RX view
  *
- * Output: 
- *    int                   :   number of instructions generated
+ * Output:
+ *    base of the RW view, exits on failure
  */
-int build_instructions(volatile char *next_ptr, int thread_id, int num_to_build) 
+volatile char *alloc_code_region(long size, volatile char **rx)
 {
-  int num_built = 0;
-  long limit = (long)mptr_threads[thread_id] + MAX_INSTR_BYTES - SAFETY_MARGIN;
-  
-  fprintf(stderr,"T%d building instructions\n", thread_id);
+  void *rw = MAP_FAILED;
 
-  // function preamble 
-  next_ptr = add_headeri(next_ptr);
-  
-  // mov mdptr into rdi
-  next_ptr = build_imm_to_register(ISZ_8, (long)mdptr_threads[thread_id], REG_EDI, next_ptr);
+  if (huge_pages)
+  {
+    rw = map_code_views(MFD_HUGETLB, size, rx);
+    if (rw == MAP_FAILED)
+    {
+      fprintf(stderr, "no hugetlb pages for code region, falling back to THP\n");
+    }
+  }
 
-  // generate n random instructions
-  for (int i = 0; i < num_to_build; i++)
+  if (rw == MAP_FAILED)
   {
-    short size; 
-    int src, safe_src, dest, type;
-    long imm;
-    int disp, disp_type; 
+    rw = map_code_views(0, size, rx);
+    if (rw == MAP_FAILED)
+    {
+      fprintf(stderr, "Couldn't mmap code region (%ld bytes): ", size);
+      perror("");
+      exit(1);
+    }
 
-    if ((long)next_ptr >= limit)
+    if (huge_pages && (madvise(rw, size, MADV_HUGEPAGE) == -1 || madvise((void *)*rx, size, MADV_HUGEPAGE) == -1))
     {
-      fprintf(stderr,"build instructions: instruction buffer full\n");
-      break;
+      perror("madvise(MADV_HUGEPAGE)");
+    }
+  }
+
+  return((volatile char *)rw);
+}
+
+/*
+ * Function: map_code_views
+ *
+ * Description:
+ *    creates a memfd of size bytes and maps it RW and RX, the file is
+ *    only referenced by the mappings afterwards
+ *
+ * Inputs:
+ *    int flags                :  extra memfd_create() flags, MFD_HUGETLB or 0
+ *    long size                :  bytes
+ *    volatile char **rx       :  returns the base of the RX view
+ *
+ * Output:
+ *    base of the RW view, MAP_FAILED with errno set if any step failed
+ */
+void *map_code_views(int flags, long size, volatile char **rx)
+{
+  void *rw = MAP_FAILED, *x = MAP_FAILED;
+  int fd, err;
+
+  // raw syscall, the glibc wrapper wants _GNU_SOURCE and its REG_* clash with ours
+  if ((fd = syscall(SYS_memfd_create, "encodeit-code", MFD_CLOEXEC | flags)) == -1)
+  {
+    return(MAP_FAILED);
+  }
+
+  if (ftruncate(fd, size) == 0)
+  {
+    rw = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    x = mmap(NULL, size, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+  }
+  err = errno;
+  close(fd);
+
+  if (rw == MAP_FAILED || x == MAP_FAILED)
+  {
+    if (rw != MAP_FAILED)
+    {
+      munmap(rw, size);
+    }
+    if (x != MAP_FAILED)
+    {
+      munmap(x, size);
     }
-    
-    // operand size 1/2/4/8
-    size = 1 << rand_range(0, 3);
+    errno = err;
+    return(MAP_FAILED);
+  }
+
+  *rx = (volatile char *)x;
+  return(rw);
+}
+
+/*
+ * Function: record_fault
+ *
+ * Description:
+ *    counts a recovered fault against the thread, keeps the details of
+ *    its first one and logs every one
+ *
+ * Inputs:
+ *    int thread_id            :  thread that faulted
+ *    long iter                :  test case it was running
+ *    funct_t entry            :  where that test case was called, rip is relative to it
+ *    const insn_ir_t *ir      :  the test case, to place the fault
+ */
+void record_fault(int thread_id, long iter, funct_t entry, const insn_ir_t *ir)
+{
+  thread_result_t *r = &results[thread_id];
+  long off = fault_last.rip - (unsigned long)entry;
+
+  if (r->faults++ == 0)
+  {
+    r->fault = fault_last;
+    r->fault_iter = iter;
+    r->fault_off = off;
+    r->fault_insn = ir_find_insn(ir, off);
+  }
+
+  if (evlogs)
+  {
+    evlog_fault(&evlogs[thread_id], iter, off, fault_last.signo, fault_last.addr);
+  }
+}
 
-    // generate 0/8/32 displacements
-    switch (rand_range(0, 2))
+// one line per thread that faulted, with where its first fault was
+void report_faults(void)
+{
+  for (int i = 0; i < nthreads; i++)
+  {
+    thread_result_t *r = &results[i];
+
+    if (r->faults)
     {
-      case 0:
-        disp_type = DISP0_MODRM;
-        disp = 0xdeadbeef;
-        break;
-            
-      case 1:
-        disp_type = DISP8_MODRM;
-        disp = rand_range(0, 127);          // negative offset falls outside mdptr
-        break;
-            
-      case 2:
-        disp_type = DISP32_MODRM;
-        disp = rand_range(0, MAX_DATA_BYTES - 8); // don't store outside buffer!
-        break;
-          
-      default:
-        fprintf(stderr,"illegal displacement type\n");
+      fprintf(stderr, "T%d %ld faults, first in test case %ld: %s (si_code %d) at +0x%lx, instruction %d, address 0x%lx\n",
+              i, r->faults, r->fault_iter, strsignal(r->fault.signo), r->fault.code, r->fault_off,
+              r->fault_insn, r->fault.addr);
     }
-    
-    // src reg
-    src = rand_range(REG_EAX, REG_EDI);
+  }
+}
+
+/*
+ * Function: executeit
+ * 
+ * Description:
+ *    This function will start executing at the function address passed into it 
+ *    and return an integer return value that will be used to indicate pass(0)/fail(1)
+ *    A fault in the generated code is caught and returned as EXEC_FAULT
+ *    with the details in fault_last; the end barrier the code never got
+ *    to is paid here, and with -k,sync the loop barriers of the
+ *    iterations after the faulting one, and nothing is checked.
+ *
+ * Inputs:  
+ *    funct_t start_addr :      function pointer 
+ *    volatile char *data  :    thread's data buffer, the code's rdi base
+ *    thread_ctx_t *ctx    :    thread's barrier context
+ *    golden_t *expect     :    golden model prediction to check against, or NULL
+ *    perfctr_t *pc        :    thread's counters, read around the generated code only
+ *    perfctr_counts_t *acc :   where the counter and TSC deltas accumulate
+ *    int thread_id        :    for mismatch reports
+ *
+ * Output:  
+ *    int                :      EXEC_PASS, EXEC_MISMATCH or EXEC_FAULT
+ */
+int executeit(funct_t start_addr, volatile char *data, thread_ctx_t *ctx, golden_t *expect,
+              perfctr_t *pc, perfctr_counts_t *acc, int thread_id) 
+{
+  volatile int rc = 0;
+  sigjmp_buf jb;
 
-    // src reg for xchg/xadd - excluding sp and rdi
-    while ((safe_src = rand_range(REG_EAX, REG_ESI)) == REG_ESP);
-    
-    // dest reg, excluding sp and rdi
-    while ((dest = rand_range(REG_EAX, REG_ESI)) == REG_ESP);
-    
-    type = rand_range(REG2REG, SFENCE);
-    switch (type)
+  perfctr_start(pc);
+  if (sigsetjmp(jb, 0) == 0)
+  {
+    fault_arm(&jb);
+    rc = (*start_addr)(data, ctx);
+    fault_disarm();
+  }
+  else
+  {
+    perfctr_stop(pc, acc);
+    if (gen_cfg.loop_count && gen_cfg.loop_barrier)
     {
-      case REG2REG:
-        next_ptr = build_mov_register_to_register(size, src, dest, next_ptr);
-        //fprintf(stderr,"reg2reg: sz %d, src %d, dest %d\n", size, src, dest);
-        break;
-        
-      case IMM2REG:
-        imm = rand();
-        if (size == 8) imm = (imm << 32) | rand();
-        next_ptr = build_imm_to_register(size, imm, dest, next_ptr);
-        //fprintf(stderr, "imm2reg: sz %d, imm %ld, dest %d\n", size, imm, dest);
-        break;
-        
-      case MEM2REG:
-        next_ptr = build_mov_memory_to_register(size, REG_EDI, dest, disp_type, disp, next_ptr);
-        //fprintf(stderr, "mem2reg: sz %d, dest %d, type %d, disp %x\n", size, dest, disp_type, disp);
+      for (unsigned long n = fault_last.r15; n > 1 && n <= (unsigned long)gen_cfg.loop_count; n--)
+      {
+        barrier_arrive(ctx);
+      }
+    }
+    if (gen_cfg.use_barrier)
+    {
+      barrier_arrive(ctx);
+    }
+    return(EXEC_FAULT);
+  }
+  perfctr_stop(pc, acc);
+
+  // the generated code's return value is whatever the body left in eax
+  if (expect)
+  {
+    return(golden_check(expect, ctx->regs, data, thread_id));
+  }
+
+  return(EXEC_PASS);
+}
+
+/*
+ * Function: test_signature
+ *
+ * Description:
+ *    hashes the thread's whole data buffer and the registers the postamble
+ *    captured into one 64-bit signature.  The body never writes the base
+ *    registers or rsp: the bases go in as offsets so the buffer's address
+ *    drops out, rsp is only captured for the golden model and is left out.
+ *
+ * Inputs:
+ *    volatile char *data  :    thread's data buffer after execution
+ *    thread_ctx_t *ctx    :    thread's context, regs filled by the postamble
+ *
+ * Output:
+ *    unsigned long      :      signature of the test case's final state
+ */
+unsigned long test_signature(volatile char *data, thread_ctx_t *ctx)
+{
+  unsigned long regs[NUM_GPRS];
+
+  memcpy(regs, ctx->regs, sizeof(regs));
+  for (int r = 0; r < NUM_GPRS; r++)
+  {
+    if (BASE_REGS & (1 << r))
+    {
+      regs[r] -= (unsigned long)data;
+    }
+  }
+  regs[REG_ESP] = 0;
+
+  return(sig_hash(regs, sizeof(regs), sig_hash(data, data_bytes, 0)));
+}
+
+/*
+ * Function: pin_worker
+ *
+ * Description:
+ *    pins the calling worker to the CPU topo_place() picked for it.  The
+ *    CPU was in our affinity mask then; if it can't be bound now (cpuset
+ *    changed, CPU offlined) the worker runs on unpinned rather than
+ *    leaving the others waiting at its barriers, and says so.
+ *
+ * Inputs:
+ *    int thread_id            :  logical thread id, for the message
+ *    int cpu                  :  CPU to bind to
+ *
+ * Output:
+ *    cpu, or -1 if the thread runs unpinned
+ */
+int pin_worker(int thread_id, int cpu)
+{
+  if (bind_to_cpu(cpu) == -1)
+  {
+    fprintf(stderr, "T%d couldn't be pinned to cpu %d, running unpinned\n", thread_id, cpu);
+    return(-1);
+  }
+
+  return(cpu);
+}
+
+/*
+ * Function: report_signatures
+ *
+ * Description:
+ *    prints every thread's chained signature.  With -U all threads ran the
+ *    same test cases, so the majority signature is the reference and any
+ *    thread that disagrees with it is flagged.  Not with -D, where the
+ *    threads race on the data they hash.
+ *
+ * Output:
+ *    int                :      number of threads flagged
+ */
+int report_signatures(void)
+{
+  unsigned long ref = 0;
+  int votes = 0, flagged = 0;
+
+  // Boyer-Moore majority vote
+  for (int i = 0; i < nthreads; i++)
+  {
+    if (votes == 0)
+    {
+      ref = results[i].sig;
+    }
+    votes += (results[i].sig == ref) ? 1 : -1;
+  }
+
+  for (int i = 0; i < nthreads; i++)
+  {
+    int bad = uniform && !gen_cfg.shared_data && results[i].sig != ref;
+
+    char where[16] = "unpinned";
+
+    if (results[i].cpu >= 0)
+    {
+      snprintf(where, sizeof(where), "cpu %d", results[i].cpu);
+    }
+    fprintf(stderr, "T%d %s signature 0x%016lx, last test case 0x%016lx%s\n",
+            i, where, results[i].sig, results[i].last_sig, bad ? "  <-- MISMATCH" : "");
+    flagged += bad;
+  }
+
+  if (flagged)
+  {
+    fprintf(stderr, "%d of %d threads disagree with signature 0x%016lx\n", flagged, nthreads, ref);
+  }
+
+  return(flagged);
+}
+
+/*
+ * Function: log_instructions
+ *
+ * Description:
+ *    appends a built test case to the thread's binary event ring, one
+ *    fixed-size record per instruction
+ *
+ * Inputs: 
+ *    evlog_t *log             :  this thread's ring
+ *    insn_ir_t *ir            :  encoded IR (code_off valid)
+ *    unsigned int iteration   :  test case number
+ */
+void log_instructions(evlog_t *log, insn_ir_t *ir, unsigned int iteration)
+{
+  evlog_event(log, EV_TEST_BEGIN, iteration, ir->count);
+
+  for (int i = 0; i < ir->count; i++)
+  {
+    evlog_insn(log, iteration, ir->code_off[i], ir->type[i], ir->size[i], ir->src[i], ir->dest[i],
+               ir->disp_type[i], ir->index[i], ir->scale[i], ir->disp[i], ir->imm[i], ir->lock[i]);
+  }
+}
+
+/*
+ * Function: ev_reg_name
+ *
+ * Description:
+ *    name of a general register as accessed at the given operand size;
+ *    byte registers 4-7 are ah..bh without a REX prefix, spl..dil with one
+ *
+ * Inputs: 
+ *    int reg                  :  register number, 0-15
+ *    int size                 :  operand size in bytes
+ *    int rex                  :  the instruction carries a REX prefix
+ *
+ * Output:
+ *    register name
+ */
+const char *ev_reg_name(int reg, int size, int rex)
+{
+  static const char *names[4][16] =
+  {
+    { "al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil",
+      "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b" },
+    { "ax", "cx", "dx", "bx", "sp", "bp", "si", "di",
+      "r8w", "r9w", "r10w", "r11w", "r12w", "r13w", "r14w", "r15w" },
+    { "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+      "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d" },
+    { "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+      "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15" }
+  };
+  static const char *high_names[] = { "ah", "ch", "dh", "bh" };
+
+  if (size == 1 && !rex && reg >= REG_ESP && reg < 8)
+  {
+    return(high_names[reg - REG_ESP]);
+  }
+
+  return(names[__builtin_ctz(size)][reg & 0xf]);
+}
+
+/*
+ * Function: dump_event_log
+ *
+ * Description:
+ *    parent side formatter, renders one thread's ring as text
+ *
+ * Inputs: 
+ *    FILE *out                :  logfile
+ *    evlog_t *log             :  ring to render
+ *    int thread_id            :  logical thread id
+ */
+void dump_event_log(FILE *out, evlog_t *log, int thread_id)
+{
+  static const char *type_names[] =
+  {
+    [REG2REG] = "reg2reg", [IMM2REG] = "imm2reg", [REG2MEM] = "reg2mem", [MEM2REG] = "mem2reg",
+    [XADD] = "xadd", [XCHG] = "xchg", [MFENCE] = "mfence", [LFENCE] = "lfence", [SFENCE] = "sfence",
+    [ADD2MEM] = "add2mem", [SUB2MEM] = "sub2mem", [AND2MEM] = "and2mem", [OR2MEM] = "or2mem",
+    [XOR2MEM] = "xor2mem", [ADD2REG] = "add2reg", [SUB2REG] = "sub2reg", [AND2REG] = "and2reg",
+    [OR2REG] = "or2reg", [XOR2REG] = "xor2reg", [INCMEM] = "inc", [DECMEM] = "dec",
+    [CMPXCHG] = "cmpxchg", [CMPXCHGB] = "cmpxchg8b/16b", [VLOADU] = "vloadu",
+    [VLOADA] = "vloada", [VSTOREU] = "vstoreu", [VSTOREA] = "vstorea", [VSTORENT] = "vstorent",
+  };
+  static const char *disp_names[] = { "disp0", "disp8", "disp32" };
+  static const char vec_names[] = { [VSZ_16] = 'x', [VSZ_32] = 'y', [VSZ_64] = 'z' };
+  unsigned long head = log->head;
+  unsigned long first = (head > EVLOG_RECORDS) ? head - EVLOG_RECORDS : 0;
+
+  fprintf(out, "T%d: %lu records", thread_id, head);
+  if (first)
+  {
+    fprintf(out, " (%lu oldest dropped)", first);
+  }
+  fprintf(out, "\n");
+
+  for (unsigned long n = first; n < head; n++)
+  {
+    evlog_rec_t *r = &log->rec[n & (EVLOG_RECORDS - 1)];
+
+    fprintf(out, "T%d it %u tsc %lu: ", thread_id, r->iteration, r->tsc);
+
+    switch (r->type)
+    {
+      case EV_TEST_BEGIN:
+        fprintf(out, "test begin, %ld instructions\n", r->imm);
         break;
 
-      case REG2MEM:
-        next_ptr = build_reg_to_memory(size, src, REG_EDI, disp_type, disp, next_ptr);
-        //fprintf(stderr, "reg2mem: sz %d, src %d, type %d, disp %x\n", size, src, disp_type, disp);
+      case EV_EXEC_BEGIN:
+        fprintf(out, "exec begin\n");
         break;
 
-      case XADD:
-      case XCHG:
-        // generate with optional lock
-        short lock = rand_range(0, 1);
-      
-        if (type == XADD)
-          next_ptr = build_xadd(size, safe_src, REG_EDI, disp_type, disp, lock, next_ptr);
-        else
-          next_ptr = build_xchg(size, safe_src, REG_EDI, disp_type, disp, lock, next_ptr);
-      
-        //fprintf(stderr, "%s: sz %d, src %d, type %d, disp %x, lock %d\n", 
-        //     (type == XADD) ? "xadd" : "xchg", size, safe_src, disp_type, disp, lock);
-      break;
+      case EV_EXEC_END:
+        fprintf(out, "exec end, rc %ld\n", r->imm);
+        break;
 
-      case MFENCE:
-        next_ptr = build_mfence(next_ptr);
+      case EV_SIGNATURE:
+        fprintf(out, "signature 0x%016lx\n", (unsigned long)r->imm);
         break;
 
-      case LFENCE:
-        next_ptr = build_lfence(next_ptr);
+      case EV_FAULT:
+        fprintf(out, "fault at +0x%04x, %s, address 0x%lx\n", r->code_off, strsignal(r->size), (unsigned long)r->imm);
         break;
 
+      case MFENCE:
+      case LFENCE:
       case SFENCE:
-        next_ptr = build_sfence(next_ptr);
+        fprintf(out, "+0x%04x %s\n", r->code_off, type_names[r->type]);
         break;
- 
+
       default:
-        fprintf(stderr, "illegal instruction type\n");
-    }
-    
-    num_built++;
-  }
+      {
+        int src = (r->regs >> 4) & 0xf;
+        int dest = r->regs & 0xf;
+        int index = r->sib & 0xf;
+        int is_mem = (r->flags & 0x3) != (BASE_MODRM >> MODRM_SHIFT);
+        long disp = r->disp;
+
+        fprintf(out, "+0x%04x %s sz %d", r->code_off, type_names[r->type], r->size);
+
+        if (IS_VEC(r->type))
+        {
+          // the vector register stands in for the reg operand, the other one is the base
+          int load = (r->type == VLOADU || r->type == VLOADA);
 
-  // function postamble
-  next_ptr = add_endi(next_ptr);
+          fprintf(out, ", %s %cmm%d, base %s", load ? "dest" : "src", vec_names[r->size],
+                  load ? dest & 0x7 : src & 0x7, ev_reg_name(load ? src : dest, 8, 1));
+        }
+        else
+        {
+          // same REX test as the golden model; NO_INDEX has no extension bit
+          int rex = r->size == 8 || ((src | dest | index) & 0x8);
+
+          if (r->type == IMM2REG)
+          {
+            unsigned long imm = r->size < 8 ? (unsigned long)r->imm & ((1UL << 8 * r->size) - 1) : (unsigned long)r->imm;
 
-  fprintf(stderr,"built %d instructions, next ptr is now 0x%lx\n", num_built, (long) next_ptr);
+            fprintf(out, ", imm 0x%lx, dest %s", imm, ev_reg_name(dest, r->size, rex));
+          }
+          else if (r->type == INCMEM || r->type == DECMEM || r->type == CMPXCHGB)
+          {
+            // no register operand, cmpxchg8b/16b's are implicit
+            fprintf(out, ", base %s", ev_reg_name(dest, 8, 1));
+          }
+          else if (is_mem)
+          {
+            // the ModRM.reg operand is sized, the r/m one is the address base
+            int reg_dest = ir_reg_is_dest[r->type];
 
-  return (num_built);
-}
\ No newline at end of file
+            fprintf(out, ", %s %s, base %s", reg_dest ? "dest" : "src", ev_reg_name(reg_dest ? dest : src, r->size, rex),
+                    ev_reg_name(reg_dest ? src : dest, 8, 1));
+          }
+          else
+          {
+            fprintf(out, ", src %s, dest %s", ev_reg_name(src, r->size, rex), ev_reg_name(dest, r->size, rex));
+          }
+        }
+        if (index != NO_INDEX)
+        {
+          fprintf(out, ", index %s*%d", ev_reg_name(index, 8, 1), 1 << (r->sib >> 4));
+        }
+
+        // DISP0 records carry a placeholder, register forms none
+        if ((r->flags & 0x3) == (DISP8_MODRM >> MODRM_SHIFT) || (r->flags & 0x3) == (DISP32_MODRM >> MODRM_SHIFT))
+        {
+          fprintf(out, ", %s %s0x%lx", disp_names[r->flags & 0x3], disp < 0 ? "-" : "", disp < 0 ? -disp : disp);
+        }
+        if (r->flags & 0x4)
+        {
+          fprintf(out, ", lock");
+        }
+        fprintf(out, "\n");
+        break;
+      }
+    }
+  }
+}
@@ -0,0 +1,79 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ * Fault recovery, see include/fault.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <ucontext.h>
+
+#include "fault.h"
+
+// gregs slot of rip; sys/ucontext.h names it REG_RIP only under _GNU_SOURCE, which clashes with REG_R8..
+#define UC_RIP   16
+#define UC_R15   7
+
+__thread sigjmp_buf *fault_jmp = NULL;
+__thread fault_t fault_last;
+
+static void fault_handler(int signo, siginfo_t *si, void *uc)
+{
+  sigjmp_buf *jb = fault_jmp;
+
+  // not in a test case: let it fault again with the default action
+  if (jb == NULL)
+  {
+    signal(signo, SIG_DFL);
+    return;
+  }
+
+  fault_last.signo = signo;
+  fault_last.code = si->si_code;
+  fault_last.addr = (unsigned long)si->si_addr;
+  fault_last.rip = ((ucontext_t *)uc)->uc_mcontext.gregs[UC_RIP];
+  fault_last.r15 = ((ucontext_t *)uc)->uc_mcontext.gregs[UC_R15];
+
+  fault_disarm();
+  siglongjmp(*jb, signo);
+}
+
+int fault_init_thread(void)
+{
+  static const int sigs[] = { SIGSEGV, SIGILL, SIGBUS };
+  struct sigaction sa = { 0 };
+  stack_t ss;
+
+  // per thread, and kept for the thread's lifetime
+  if ((ss.ss_sp = malloc(FAULT_STACK)) == NULL)
+  {
+    perror("fault stack");
+    return(-1);
+  }
+  ss.ss_size = FAULT_STACK;
+  ss.ss_flags = 0;
+
+  if (sigaltstack(&ss, NULL) == -1)
+  {
+    perror("sigaltstack");
+    free(ss.ss_sp);
+    return(-1);
+  }
+
+  sa.sa_sigaction = fault_handler;
+  sa.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_NODEFER;
+  sigemptyset(&sa.sa_mask);
+
+  for (int k = 0; k < (int)(sizeof(sigs) / sizeof(sigs[0])); k++)
+  {
+    if (sigaction(sigs[k], &sa, NULL) == -1)
+    {
+      perror("sigaction");
+      return(-1);
+    }
+  }
+
+  return(0);
+}
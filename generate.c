@@ -0,0 +1,756 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ * Test case generation, see include/generate.h
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <limits.h>
+
+#include "generate.h"
+#include "golden.h"
+
+gen_config_t gen_cfg =
+{
+  .data_bytes = DEF_DATA_BYTES,
+  .use_barrier = 1,
+  .vec_width = VSZ_16,
+};
+
+/*
+ * Generated test case frame
+ *
+ * The code is called as test(data, ctx): rdi is the data buffer, rsi the
+ * thread's thread_ctx_t.  The preamble copies rdi into the other base
+ * registers and loads the index register (see golden.h); the random body
+ * never writes those or rsp.  ctx is saved in the enter frame, just above
+ * the six callee-saved pushes, where the postamble can find it again
+ * after the body has clobbered rsi.
+ */
+#define CTX_SLOT    48
+#define SAVE_SLOT   (CTX_SLOT + 8)
+#define LOOP_SLOT   (SAVE_SLOT + 8)     // rax/rcx/rdx/rsi around a loop barrier
+
+// registers a loop barrier clobbers, rsi included since it has to hold ctx
+static const unsigned char loop_saved[] = { REG_EAX, REG_ECX, REG_EDX, REG_ESI };
+
+/*
+ * Function: add_capture
+ *
+ * Description:
+ *    emits stores of the architectural registers into ctx->regs so they can
+ *    be checked after the test, rax is parked in a frame slot while it
+ *    holds ctx
+ */
+static inline volatile char *add_capture(volatile char *tgt_addr)
+{
+  tgt_addr = build_rsp_store(REG_EAX, SAVE_SLOT, tgt_addr);
+  tgt_addr = build_rsp_load(REG_EAX, CTX_SLOT, tgt_addr);
+
+  for (int r = REG_ECX; r < NUM_GPRS; r++)
+  {
+    if (CHECKED_REGS & (1 << r))
+    {
+      tgt_addr = build_reg_to_memory(ISZ_8, r, REG_EAX, DISP32_MODRM, offsetof(thread_ctx_t, regs[r]), tgt_addr);
+    }
+  }
+
+  tgt_addr = build_rsp_load(REG_ECX, SAVE_SLOT, tgt_addr);
+  tgt_addr = build_reg_to_memory(ISZ_8, REG_ECX, REG_EAX, DISP32_MODRM, offsetof(thread_ctx_t, regs[REG_EAX]), tgt_addr);
+
+  // the body may read rsp but never moves it, the model needs its value
+  tgt_addr = build_reg_to_memory(ISZ_8, REG_ESP, REG_EAX, DISP32_MODRM, offsetof(thread_ctx_t, regs[REG_ESP]), tgt_addr);
+
+  return(tgt_addr);
+}
+
+/*
+ * Function: add_barrier
+ *
+ * Description:
+ *    emits a sense-reversing spin barrier on ctx->barrier, expects ctx in
+ *    rsi and clobbers rax/rcx/rdx.  Every thread flips its own sense and
+ *    lock xadds the shared count; the last one in resets the count and
+ *    publishes the new sense, everyone else spins on it.
+ */
+static inline volatile char *add_barrier(volatile char *tgt_addr)
+{
+  volatile char *spin, *not_last, *done;
+
+  // rcx = shared barrier, eax = this thread's flipped sense
+  tgt_addr = build_mov_memory_to_register(ISZ_8, REG_ESI, REG_ECX, DISP8_MODRM, offsetof(thread_ctx_t, barrier), tgt_addr);
+  tgt_addr = build_mov_memory_to_register(ISZ_4, REG_ESI, REG_EAX, DISP8_MODRM, offsetof(thread_ctx_t, sense), tgt_addr);
+  tgt_addr = build_alu_imm8(ALU_XOR, ISZ_4, REG_EAX, 1, tgt_addr);
+  tgt_addr = build_reg_to_memory(ISZ_4, REG_EAX, REG_ESI, DISP8_MODRM, offsetof(thread_ctx_t, sense), tgt_addr);
+
+  // edx = arrivals including this one
+  tgt_addr = build_imm_to_register(ISZ_4, 1, REG_EDX, tgt_addr);
+  tgt_addr = build_xadd(ISZ_4, REG_EDX, REG_ECX, DISP8_MODRM, offsetof(barrier_t, count), 1, tgt_addr);
+  tgt_addr = build_alu_imm8(ALU_ADD, ISZ_4, REG_EDX, 1, tgt_addr);
+  tgt_addr = build_cmp_memory_to_register(REG_ESI, REG_EDX, offsetof(thread_ctx_t, nthreads), tgt_addr);
+  tgt_addr = not_last = build_jcc8(CC_NE, 0, tgt_addr);
+
+  // last one in: reset for the next barrier, then release everyone
+  tgt_addr = build_imm_to_memory(0, REG_ECX, offsetof(barrier_t, count), tgt_addr);
+  tgt_addr = build_reg_to_memory(ISZ_4, REG_EAX, REG_ECX, DISP8_MODRM, offsetof(barrier_t, sense), tgt_addr);
+  tgt_addr = done = build_jmp8(0, tgt_addr);
+
+  // everyone else waits for the shared sense to match theirs
+  patch_rel8(not_last, tgt_addr);
+  spin = tgt_addr;
+  tgt_addr = build_pause(tgt_addr);
+  tgt_addr = build_cmp_memory_to_register(REG_ECX, REG_EAX, offsetof(barrier_t, sense), tgt_addr);
+  tgt_addr = build_jcc8(CC_NE, 0, tgt_addr);
+  patch_rel8(tgt_addr, spin);
+
+  patch_rel8(done, tgt_addr);
+  return(tgt_addr);
+}
+
+/*
+ * Function: add_loop_barrier
+ *
+ * Description:
+ *    emits a barrier in the middle of the body's registers: the ones
+ *    add_barrier() clobbers are parked in frame slots around it and rsi
+ *    is pointed at ctx again.  Flags are lost, nothing in a body reads them.
+ */
+static inline volatile char *add_loop_barrier(volatile char *tgt_addr)
+{
+  int n = sizeof(loop_saved);
+
+  for (int k = 0; k < n; k++)
+  {
+    tgt_addr = build_rsp_store(loop_saved[k], LOOP_SLOT + 8 * k, tgt_addr);
+  }
+  tgt_addr = build_rsp_load(REG_ESI, CTX_SLOT, tgt_addr);
+
+  tgt_addr = add_barrier(tgt_addr);
+
+  for (int k = 0; k < n; k++)
+  {
+    tgt_addr = build_rsp_load(loop_saved[k], LOOP_SLOT + 8 * k, tgt_addr);
+  }
+
+  return(tgt_addr);
+}
+
+static inline volatile char *add_headeri(volatile char *tgt_addr)
+{
+  // setup stack
+  tgt_addr = build_enter(2048, tgt_addr);
+
+  // stash ctx for the postamble
+  tgt_addr = build_rsp_store(REG_ESI, 0, tgt_addr);
+  
+  // save caller regs
+  tgt_addr = build_push_reg(REG_EBX, 0, tgt_addr);
+  tgt_addr = build_push_reg(REG_EBP, 0, tgt_addr);
+  tgt_addr = build_push_reg(REG_R12, 1, tgt_addr);
+  tgt_addr = build_push_reg(REG_R13, 1, tgt_addr);
+  tgt_addr = build_push_reg(REG_R14, 1, tgt_addr);
+  tgt_addr = build_push_reg(REG_R15, 1, tgt_addr);
+
+  // vector registers start out zero, as the golden model assumes
+  if (gen_cfg.avx)
+  {
+    tgt_addr = build_vzeroall(tgt_addr);
+  }
+  else
+  {
+    for (int v = 0; v < NUM_VREGS; v++)
+    {
+      tgt_addr = build_pxor_self(v, tgt_addr);
+    }
+  }
+
+  // line all threads up right before the random code
+  if (gen_cfg.use_barrier)
+  {
+    tgt_addr = add_barrier(tgt_addr);
+  }
+  
+  return(tgt_addr);
+}
+
+static inline volatile char *add_endi(volatile char *tgt_addr)
+{
+  // architectural state for checking
+  tgt_addr = add_capture(tgt_addr);
+
+  if (gen_cfg.avx)
+  {
+    tgt_addr = build_vzeroupper(tgt_addr);
+  }
+
+  // and again once everyone has finished it
+  if (gen_cfg.use_barrier)
+  {
+    tgt_addr = build_rsp_load(REG_ESI, CTX_SLOT, tgt_addr);
+    tgt_addr = add_barrier(tgt_addr);
+  }
+
+  // restore regs
+  tgt_addr = build_pop_reg(REG_R15, 1, tgt_addr);
+  tgt_addr = build_pop_reg(REG_R14, 1, tgt_addr);
+  tgt_addr = build_pop_reg(REG_R13, 1, tgt_addr);
+  tgt_addr = build_pop_reg(REG_R12, 1, tgt_addr);
+  tgt_addr = build_pop_reg(REG_EBP, 0, tgt_addr);
+  tgt_addr = build_pop_reg(REG_EBX, 0, tgt_addr);
+  
+  // break down stack
+  tgt_addr = build_leave(tgt_addr);
+  tgt_addr = build_return(tgt_addr);
+  
+  return(tgt_addr);
+}
+
+volatile char *gen_preamble(volatile char *tgt_addr)
+{
+  return(add_headeri(tgt_addr));
+}
+
+volatile char *gen_postamble(volatile char *tgt_addr)
+{
+  return(add_endi(tgt_addr));
+}
+
+volatile char *gen_barrier(volatile char *tgt_addr)
+{
+  return(add_barrier(tgt_addr));
+}
+
+int gen_shared_init(int nthreads)
+{
+  long hot_bytes = (long)gen_cfg.hot_lines * LINE_BYTES;
+
+  if (gen_cfg.hot_lines < 1 || gen_cfg.hot_pct < 0 || gen_cfg.hot_pct > 100)
+  {
+    fprintf(stderr, "hot set needs at least one line and a percentage between 0 and 100\n");
+    return(-1);
+  }
+
+  if (gen_cfg.false_sharing && nthreads > LINE_BYTES)
+  {
+    fprintf(stderr, "false sharing needs at least a byte of a line per thread, %d threads\n", nthreads);
+    return(-1);
+  }
+
+  // largest power of 2 share of a line, operands are aligned within it
+  for (gen_cfg.slot_bytes = ISZ_8; gen_cfg.slot_bytes * nthreads > LINE_BYTES; gen_cfg.slot_bytes >>= 1);
+
+  gen_cfg.cold_bytes = (gen_cfg.data_bytes - hot_bytes) / nthreads / LINE_BYTES * LINE_BYTES;
+  if (gen_cfg.cold_bytes < LINE_BYTES)
+  {
+    fprintf(stderr, "%d hot lines leave no room for %d private slices in %ld bytes\n",
+            gen_cfg.hot_lines, nthreads, gen_cfg.data_bytes);
+    return(-1);
+  }
+
+  gen_cfg.shared_data = 1;
+  return(0);
+}
+
+/*
+ * Function: shared_address
+ *
+ * Description:
+ *    picks the data offset of a memory operand in a -D shared region and
+ *    the smallest displacement form that reaches it, narrowing size for
+ *    false sharing slots.  wide is 2 for cmpxchg8b/16b, which access a
+ *    pair of size operands and want the pair aligned.
+ */
+static void shared_address(rng_t *rng, int thread_id, short *size, int wide, int *disp_type, int *disp)
+{
+  long off;
+  int bytes;
+
+  if (rng_range(rng, 0, 99) < gen_cfg.hot_pct)
+  {
+    long line = (long)rng_range(rng, 0, gen_cfg.hot_lines - 1) * LINE_BYTES;
+
+    if (gen_cfg.false_sharing)
+    {
+      int slot = gen_cfg.slot_bytes;
+
+      if (*size * wide > slot)
+      {
+        *size = slot / wide;
+      }
+      bytes = *size * wide;
+      off = line + thread_id * slot + rng_range(rng, 0, slot / bytes - 1) * bytes;
+    }
+    else
+    {
+      bytes = *size * wide;
+      off = line + rng_range(rng, 0, LINE_BYTES / bytes - 1) * bytes;
+    }
+  }
+  else
+  {
+    bytes = *size * wide;
+    off = (long)gen_cfg.hot_lines * LINE_BYTES + thread_id * gen_cfg.cold_bytes
+        + rng_range(rng, 0, gen_cfg.cold_bytes - bytes);
+    if (wide > 1)
+    {
+      off &= ~(long)(bytes - 1);
+    }
+  }
+
+  *disp = off;
+  *disp_type = (off < 128) ? DISP8_MODRM : DISP32_MODRM;
+}
+
+int gen_vec_init(int max_width)
+{
+  int hw = VSZ_16;
+
+  __builtin_cpu_init();
+  gen_cfg.avx = __builtin_cpu_supports("avx");
+  if (gen_cfg.avx)
+  {
+    hw = __builtin_cpu_supports("avx512f") ? VSZ_64 : VSZ_32;
+  }
+
+  gen_cfg.vec_width = (max_width < hw) ? max_width : hw;
+  return(gen_cfg.vec_width);
+}
+
+/*
+ * Function: vec_address
+ *
+ * Description:
+ *    picks the data offset and displacement form of a vector access.  The
+ *    aligned and non-temporal forms get a width aligned offset, the
+ *    unaligned ones either straddle a cache line boundary (split) or sit
+ *    inside one line.  disp_type comes in as drawn: DISP0 stays at offset
+ *    0, DISP8 keeps to the first two lines, DISP32 ranges over the buffer.
+ *    With -D the access goes to the hot set or the thread's private slice
+ *    instead; a false sharing slot can't hold a vector, so those always
+ *    go to the private slice.
+ */
+static void vec_address(rng_t *rng, int type, short width, int thread_id, int split, int *disp_type, int *disp)
+{
+  int aligned = (type != VLOADU && type != VSTOREU);
+  int shift = enc_lookup(type, width)->disp8_shift;
+  long first = 0, lines, line, off;
+
+  if (gen_cfg.shared_data)
+  {
+    if (!gen_cfg.false_sharing && rng_range(rng, 0, 99) < gen_cfg.hot_pct)
+    {
+      lines = gen_cfg.hot_lines;
+    }
+    else
+    {
+      first = gen_cfg.hot_lines + thread_id * gen_cfg.cold_bytes / LINE_BYTES;
+      lines = gen_cfg.cold_bytes / LINE_BYTES;
+    }
+  }
+  else if (*disp_type == DISP0_MODRM)
+  {
+    return;
+  }
+  else
+  {
+    lines = (*disp_type == DISP8_MODRM) ? 2 : gen_cfg.data_bytes / LINE_BYTES;
+  }
+
+  // a split needs the line after it in range too
+  if (split && !aligned && lines > 1)
+  {
+    line = first + rng_range(rng, 0, lines - 2);
+    off = (line + 1) * LINE_BYTES - rng_range(rng, 1, width - 1);
+  }
+  else
+  {
+    line = first + rng_range(rng, 0, lines - 1);
+    off = line * LINE_BYTES + (aligned ? rng_range(rng, 0, LINE_BYTES / width - 1) * width
+                                       : rng_range(rng, 0, LINE_BYTES - width));
+  }
+
+  // EVEX scales disp8 by the vector width
+  *disp = off;
+  *disp_type = ((gen_cfg.shared_data || *disp_type == DISP8_MODRM) &&
+                !(off & ((1 << shift) - 1)) && (off >> shift) < 128) ? DISP8_MODRM : DISP32_MODRM;
+}
+
+// registers the body may write: all but rsp, the bases and the index;
+// a looped body leaves the last one to the loop counter, LOOP_REG
+static const unsigned char dest_regs[] =
+{
+  REG_EAX, REG_ECX, REG_EDX, REG_EBX, REG_EBP, REG_ESI,
+  REG_R8, REG_R9, REG_R10, REG_R11, REG_R15
+};
+#define NUM_DEST_REGS  (int)(sizeof(dest_regs) / sizeof(dest_regs[0]))
+
+static const unsigned char base_regs[] = { REG_EDI, REG_R12, REG_R13 };
+
+// a displacement the form can encode, EVEX disp8 in units of 1 << shift
+static inline int disp_fits(int disp_type, long disp, int shift)
+{
+  return(disp_type == DISP32_MODRM ||
+         (disp_type == DISP8_MODRM && !(disp & ((1 << shift) - 1)) && (disp >> shift) >= -128 && (disp >> shift) < 128));
+}
+
+// LOCK prefix for a lockable type, -M sets the odds
+static inline short draw_lock(const profile_t *prof, rng_t *rng)
+{
+  return(prof ? (rng_range(rng, 0, 99) < prof->lock_pct) : rng_range(rng, 0, 1));
+}
+
+/*
+ * Function: generate_instructions
+ *
+ * Description:
+ *    generation phase: makes every random choice for a test case and
+ *    records it in the IR, nothing is encoded here
+ *
+ * Inputs: 
+ *    insn_ir_t *ir            :  IR to fill, must hold num_to_build entries
+ *    int num_to_build         :  number of random instructions to generate
+ *    int thread_id            :  logical thread id, picks the -D private slice/slot
+ *    rng_t *rng               :  this thread's random stream
+ *
+ * Output: 
+ *    int                   :   number of instructions generated
+ */
+int generate_instructions(insn_ir_t *ir, int num_to_build, int thread_id, rng_t *rng) 
+{
+  int num_dest = gen_cfg.loop_count ? NUM_DEST_REGS - 1 : NUM_DEST_REGS;
+  int i;
+
+  // generate n random instructions
+  for (i = 0; i < num_to_build && i < ir->cap; i++)
+  {
+    short size; 
+    int src, safe_src, dest, type;
+    long imm = 0;
+    int disp, disp_type; 
+    short lock = 0;
+    int index = NO_INDEX, scale = 0;
+    const profile_t *prof = gen_cfg.profile;
+    
+    // operand size 1/2/4/8
+    size = 1 << (prof ? alias_draw(&prof->size, rng) : rng_range(rng, 0, 3));
+
+    // generate 0/8/32 displacements
+    switch (prof ? alias_draw(&prof->disp, rng) : rng_range(rng, 0, 2))
+    {
+      case 0:
+        disp_type = DISP0_MODRM;
+        disp = 0xdeadbeef;
+        break;
+            
+      case 1:
+        disp_type = DISP8_MODRM;
+        disp = rng_range(rng, 0, 127);          // negative offset falls outside mdptr
+        break;
+            
+      default:
+        disp_type = DISP32_MODRM;
+        disp = rng_range(rng, 0, gen_cfg.data_bytes - 8); // don't store outside buffer!
+        break;
+    }
+    
+    // src reg
+    src = rng_range(rng, REG_EAX, NUM_GPRS - 1);
+
+    // src reg for xchg/xadd, which write it
+    safe_src = dest_regs[rng_range(rng, 0, num_dest - 1)];
+
+    // -U: addresses differ between threads, keep them out of the results
+    if (gen_cfg.uniform)
+    {
+      src = safe_src;
+    }
+    
+    // dest reg
+    dest = dest_regs[rng_range(rng, 0, num_dest - 1)];
+    
+    type = prof ? alias_draw(&prof->type, rng) : rng_range(rng, REG2REG, NUM_TYPES - 1);
+    switch (type)
+    {
+      case REG2REG:
+        disp_type = BASE_MODRM;
+        break;
+        
+      case IMM2REG:
+        imm = rng_next(rng) & INT_MAX;
+        if (size == 8) imm = (long)rng_next(rng);
+        src = 0;
+        disp_type = BASE_MODRM;
+        break;
+        
+      case MEM2REG:
+        src = REG_EDI;
+        break;
+
+      case REG2MEM:
+        dest = REG_EDI;
+        break;
+
+      case XADD:
+      case XCHG:
+      case CMPXCHG:
+        // generate with optional lock
+        lock = draw_lock(prof, rng);
+        src = safe_src;
+        dest = REG_EDI;
+        break;
+
+      case ADD2MEM:
+      case SUB2MEM:
+      case AND2MEM:
+      case OR2MEM:
+      case XOR2MEM:
+        lock = draw_lock(prof, rng);
+        dest = REG_EDI;
+        break;
+
+      case ADD2REG:
+      case SUB2REG:
+      case AND2REG:
+      case OR2REG:
+      case XOR2REG:
+        src = REG_EDI;
+        break;
+
+      case INCMEM:
+      case DECMEM:
+        lock = draw_lock(prof, rng);
+        imm = 1;
+        src = 0;
+        dest = REG_EDI;
+        break;
+
+      case CMPXCHGB:
+        lock = draw_lock(prof, rng);
+        src = 0;
+        dest = REG_EDI;
+
+        // only the 8 and 16 byte pairs exist, and 16b must be aligned
+        size = (size == ISZ_8) ? ISZ_8 : ISZ_4;
+        if (disp_type != DISP0_MODRM)
+        {
+          disp &= ~(2 * size - 1);
+        }
+
+        // a false sharing slot too small for even the 8 byte pair
+        if (gen_cfg.shared_data && gen_cfg.false_sharing && gen_cfg.slot_bytes < 2 * ISZ_4)
+        {
+          type = CMPXCHG;
+          src = safe_src;
+        }
+        break;
+
+      case MFENCE:
+      case LFENCE:
+      case SFENCE:
+        src = dest = 0;
+        disp_type = BASE_MODRM;
+        break;
+
+      case VLOADU:
+      case VLOADA:
+      case VSTOREU:
+      case VSTOREA:
+      case VSTORENT:
+      {
+        // widths the CPU or -V rules out fall back to the widest allowed
+        int max_k = __builtin_ctz(gen_cfg.vec_width) - __builtin_ctz(VSZ_16);
+        int k = prof ? alias_draw(&prof->vec, rng) : rng_range(rng, 0, max_k);
+        int vreg = rng_range(rng, 0, NUM_VREGS - 1);
+        int split = prof ? (rng_range(rng, 0, 99) < prof->split_pct) : rng_range(rng, 0, 1);
+
+        size = VSZ_16 << (k < max_k ? k : max_k);
+        src = (type == VLOADU || type == VLOADA) ? REG_EDI : vreg;
+        dest = (type == VLOADU || type == VLOADA) ? vreg : REG_EDI;
+        vec_address(rng, type, size, thread_id, split, &disp_type, &disp);
+        break;
+      }
+    }
+
+    // -D: memory operands go to the hot set or the thread's private slice
+    if (gen_cfg.shared_data && disp_type != BASE_MODRM && !IS_VEC(type))
+    {
+      shared_address(rng, thread_id, &size, (type == CMPXCHGB) ? 2 : 1, &disp_type, &disp);
+    }
+
+    // memory operands: any base, and maybe the index with the displacement
+    // taking up the difference, as long as its form can hold it
+    if (disp_type != BASE_MODRM)
+    {
+      int base = base_regs[rng_range(rng, 0, sizeof(base_regs) - 1)];
+      int use_index = prof ? (rng_range(rng, 0, 99) < prof->index_pct) : rng_range(rng, 0, 1);
+
+      if (ir_reg_is_dest[type])
+      {
+        src = base;
+      }
+      else
+      {
+        dest = base;
+      }
+
+      if (use_index)
+      {
+        long scaled;
+
+        scale = rng_range(rng, 0, 3);
+        scaled = (long)INDEX_VALUE << scale;
+
+        // DISP0 just moves to the scaled index, a line multiple like every other alignment here
+        if (disp_type == DISP0_MODRM || disp_fits(disp_type, disp - scaled, enc_lookup(type, size)->disp8_shift))
+        {
+          index = INDEX_REG;
+          disp -= (disp_type == DISP0_MODRM) ? 0 : scaled;
+        }
+        else
+        {
+          scale = 0;
+        }
+      }
+    }
+
+    ir->type[i] = type;
+    ir->size[i] = size;
+    ir->src[i] = src;
+    ir->dest[i] = dest;
+    ir->disp_type[i] = disp_type;
+    ir->index[i] = index;
+    ir->scale[i] = scale;
+    ir->disp[i] = disp;
+    ir->imm[i] = imm;
+    ir->lock[i] = lock;
+  }
+
+  ir->count = i;
+  return (i);
+}
+
+/*
+ * Function: encode_test
+ *
+ * Description:
+ *    encodes a test case's IR into a code buffer between the preamble,
+ *    which loads init_regs, and the postamble.  Split from generation so
+ *    an IR that was edited after the fact (minimization) can be rebuilt.
+ *    With ir->loops the body is wrapped in a loop that counts LOOP_REG
+ *    down to 0 and jumps back with a near jnz, optionally taking a spin
+ *    barrier at the top of every iteration (gen_cfg.loop_barrier), so
+ *    the threads race through the same body loops times per call.
+ *
+ * Inputs: 
+ *    volatile char *next_ptr  :  start of the code buffer
+ *    long code_bytes          :  size of the code buffer
+ *    insn_ir_t *ir            :  test case, count is cut back if the buffer fills
+ *
+ * Output: 
+ *    returns adjusted address after the postamble
+ */
+volatile char *encode_test(volatile char *next_ptr, long code_bytes, insn_ir_t *ir)
+{
+  volatile char *base = next_ptr, *top;
+  int num_built = 0;
+  long limit = (long)base + code_bytes - SAFETY_MARGIN;
+
+  // function preamble, the thread's data buffer arrives in rdi
+  next_ptr = add_headeri(next_ptr);
+
+  for (int r = REG_EAX; r < NUM_GPRS; r++)
+  {
+    if ((BASE_REGS & ~(1 << REG_EDI)) & (1 << r))
+    {
+      next_ptr = build_mov_register_to_register(ISZ_8, REG_EDI, r, next_ptr);
+    }
+    else if ((CHECKED_REGS & ~BASE_REGS) & (1 << r))
+    {
+      next_ptr = build_imm_to_register(ISZ_8, ir->init_regs[r], r, next_ptr);
+    }
+  }
+
+  // LOOP_REG came in from init_regs as the iteration count
+  top = next_ptr;
+  if (ir->loops && gen_cfg.loop_barrier)
+  {
+    next_ptr = add_loop_barrier(next_ptr);
+  }
+
+  // bulk encode the test case
+  next_ptr = ir_encode(ir, base, next_ptr, limit, &num_built);
+  if (num_built < ir->count)
+  {
+    fprintf(stderr,"build instructions: instruction buffer full\n");
+    ir->count = num_built;
+  }
+
+  // count down and go round again, the body can be longer than a short jump
+  if (ir->loops)
+  {
+    next_ptr = build_alu_imm8(ALU_ADD, ISZ_8, LOOP_REG, -1, next_ptr);
+    next_ptr = build_jcc32(CC_NE, 0, next_ptr);
+    patch_rel32(next_ptr, top);
+  }
+
+  // function postamble
+  return(add_endi(next_ptr));
+}
+
+/*
+ * Function: build_instructions
+ *
+ * Description:
+ *    generates a random test case into the IR, then encodes it into the
+ *    thread's code buffer between the preamble and postamble
+ *
+ * Inputs: 
+ *    volatile char *next_ptr  :  start of this thread's code buffer
+ *    long code_bytes          :  size of the code buffer
+ *    int thread_id            :  logical thread id, for messages
+ *    int num_to_build         :  number of random instructions to generate
+ *    rng_t *rng               :  this thread's random stream
+ *    insn_ir_t *ir            :  IR for this thread, num_to_build entries
+ *
+ * Output: 
+ *    int                   :   number of instructions built
+ */
+int build_instructions(volatile char *next_ptr, long code_bytes, int thread_id, int num_to_build, rng_t *rng, insn_ir_t *ir) 
+{
+  if (!gen_cfg.quiet)
+  {
+    fprintf(stderr,"T%d building instructions\n", thread_id);
+  }
+
+  generate_instructions(ir, num_to_build, thread_id, rng);
+
+  // known starting values for every register the body may touch, the bases are the data pointer
+  memset(ir->init_regs, 0, sizeof(ir->init_regs));
+  for (int r = REG_EAX; r < NUM_GPRS; r++)
+  {
+    if ((CHECKED_REGS & ~BASE_REGS) & (1 << r))
+    {
+      ir->init_regs[r] = rng_next(rng);
+    }
+  }
+  ir->init_regs[INDEX_REG] = INDEX_VALUE;
+
+  // -k: the preamble loads the loop counter like any other register
+  ir->loops = gen_cfg.loop_count;
+  if (ir->loops)
+  {
+    ir->init_regs[LOOP_REG] = ir->loops;
+  }
+
+  next_ptr = encode_test(next_ptr, code_bytes, ir);
+
+  if (!gen_cfg.quiet)
+  {
+    fprintf(stderr,"built %d instructions, next ptr is now 0x%lx\n", ir->count, (long) next_ptr);
+  }
+
+  return (ir->count);
+}
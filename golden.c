@@ -0,0 +1,394 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ * Software golden model, see include/golden.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "golden.h"
+
+#define SHADOW_SLACK   8
+
+static const unsigned long size_mask[ISZ_8 + 1] =
+{
+  0, 0xff, 0xffff, 0, 0xffffffff, 0, 0, 0, ~0UL
+};
+
+// bits a register write replaces: 32-bit writes zero extend, 8/16-bit merge
+static const unsigned long write_mask[ISZ_8 + 1] =
+{
+  0, 0xff, 0xffff, 0, ~0UL, 0, 0, 0, ~0UL
+};
+
+/*
+ * Per-type dataflow, so the interpreter loop has no data dependent
+ * branches (the instruction mix is random, a switch would mispredict on
+ * nearly every op):
+ *
+ *    y     = src, imm or mem                        (y_sel)
+ *    x     = mem or the dest register               (x_sel)
+ *    res   = y, x + y, x - y, x & y, x | y, x ^ y   (fn)
+ *    mem'  = res if mem_res, else mem
+ *    reg'  = res to dest, or mem to src (xadd/xchg), per reg_out
+ *
+ * A type that writes no register writes a scratch slot, non-memory types
+ * access a scratch word.  The compare-exchange family is the exception:
+ * it is conditional on the comparison and has its own path.  So are the
+ * vector loads and stores, which move whole xmm/ymm/zmm registers.
+ */
+#define Y_SRC       0
+#define Y_IMM       1
+#define Y_MEM       2
+
+#define X_MEM       0
+#define X_DEST      1
+
+#define FN_Y        0
+#define FN_ADD      1
+#define FN_SUB      2
+#define FN_AND      3
+#define FN_OR       4
+#define FN_XOR      5
+
+#define OUT_NONE    0     // scratch
+#define OUT_DEST    1     // dest = res
+#define OUT_SRC     2     // src = mem
+
+#define VEC_NONE    0
+#define VEC_LOAD    1
+#define VEC_STORE   2
+
+typedef struct
+{
+  unsigned char is_mem;
+  unsigned char wide;           // operand pair (cmpxchg8b/16b), 2 * size bytes
+  unsigned char y_sel, x_sel, fn;
+  unsigned char mem_res;        // memory takes res
+  unsigned char reg_out;
+  unsigned char cmpxchg;        // compare-exchange path
+  unsigned char vec;            // vector load/store path, VEC_*
+} golden_op_t;
+
+static const golden_op_t golden_ops[NUM_TYPES] =
+{
+  //           mem wide y_sel  x_sel   fn      mem_res reg_out   cx vec
+  [REG2REG] = { 0, 0,   Y_SRC, X_MEM,  FN_Y,   0,      OUT_DEST, 0 },
+  [IMM2REG] = { 0, 0,   Y_IMM, X_MEM,  FN_Y,   0,      OUT_DEST, 0 },
+  [REG2MEM] = { 1, 0,   Y_SRC, X_MEM,  FN_Y,   1,      OUT_NONE, 0 },
+  [MEM2REG] = { 1, 0,   Y_MEM, X_MEM,  FN_Y,   0,      OUT_DEST, 0 },
+  [XADD]    = { 1, 0,   Y_SRC, X_MEM,  FN_ADD, 1,      OUT_SRC,  0 },
+  [XCHG]    = { 1, 0,   Y_SRC, X_MEM,  FN_Y,   1,      OUT_SRC,  0 },
+  [MFENCE]  = { 0, 0,   Y_SRC, X_MEM,  FN_Y,   0,      OUT_NONE, 0 },
+  [LFENCE]  = { 0, 0,   Y_SRC, X_MEM,  FN_Y,   0,      OUT_NONE, 0 },
+  [SFENCE]  = { 0, 0,   Y_SRC, X_MEM,  FN_Y,   0,      OUT_NONE, 0 },
+  [ADD2MEM] = { 1, 0,   Y_SRC, X_MEM,  FN_ADD, 1,      OUT_NONE, 0 },
+  [SUB2MEM] = { 1, 0,   Y_SRC, X_MEM,  FN_SUB, 1,      OUT_NONE, 0 },
+  [AND2MEM] = { 1, 0,   Y_SRC, X_MEM,  FN_AND, 1,      OUT_NONE, 0 },
+  [OR2MEM]  = { 1, 0,   Y_SRC, X_MEM,  FN_OR,  1,      OUT_NONE, 0 },
+  [XOR2MEM] = { 1, 0,   Y_SRC, X_MEM,  FN_XOR, 1,      OUT_NONE, 0 },
+  [ADD2REG] = { 1, 0,   Y_MEM, X_DEST, FN_ADD, 0,      OUT_DEST, 0 },
+  [SUB2REG] = { 1, 0,   Y_MEM, X_DEST, FN_SUB, 0,      OUT_DEST, 0 },
+  [AND2REG] = { 1, 0,   Y_MEM, X_DEST, FN_AND, 0,      OUT_DEST, 0 },
+  [OR2REG]  = { 1, 0,   Y_MEM, X_DEST, FN_OR,  0,      OUT_DEST, 0 },
+  [XOR2REG] = { 1, 0,   Y_MEM, X_DEST, FN_XOR, 0,      OUT_DEST, 0 },
+  [INCMEM]  = { 1, 0,   Y_IMM, X_MEM,  FN_ADD, 1,      OUT_NONE, 0 },
+  [DECMEM]  = { 1, 0,   Y_IMM, X_MEM,  FN_SUB, 1,      OUT_NONE, 0 },
+  [CMPXCHG] = { 1, 0,   Y_SRC, X_MEM,  FN_Y,   0,      OUT_NONE, 1 },
+  [CMPXCHGB] = { 1, 1,  Y_SRC, X_MEM,  FN_Y,   0,      OUT_NONE, 1 },
+  [VLOADU]   = { 1, 0,  Y_SRC, X_MEM,  FN_Y,   0,      OUT_NONE, 0, VEC_LOAD },
+  [VLOADA]   = { 1, 0,  Y_SRC, X_MEM,  FN_Y,   0,      OUT_NONE, 0, VEC_LOAD },
+  [VSTOREU]  = { 1, 0,  Y_SRC, X_MEM,  FN_Y,   0,      OUT_NONE, 0, VEC_STORE },
+  [VSTOREA]  = { 1, 0,  Y_SRC, X_MEM,  FN_Y,   0,      OUT_NONE, 0, VEC_STORE },
+  [VSTORENT] = { 1, 0,  Y_SRC, X_MEM,  FN_Y,   0,      OUT_NONE, 0, VEC_STORE },
+};
+
+#define ALL   ~0UL
+
+// displacement kept per ModR/M form, DISP0 entries carry a don't-care disp
+static const unsigned long disp_mask[4] = { 0, ALL, ALL, 0 };
+
+#define SCRATCH_REG   NUM_GPRS
+
+// without a REX prefix byte registers 4-7 are ah/ch/dh/bh, with one spl/bpl/sil/dil
+static inline int high_byte(int r, int size, int rex)
+{
+  return((size == ISZ_1) & !rex & (r >= REG_ESP) & (r <= REG_EDI));
+}
+
+static inline unsigned long read_reg(const unsigned long *regs, int r, int size, int rex)
+{
+  int hb = high_byte(r, size, rex);
+
+  return((regs[r - hb * REG_ESP] >> (hb * 8)) & size_mask[size]);
+}
+
+static inline void write_reg(unsigned long *regs, int r, int size, int rex, unsigned long val)
+{
+  int hb = high_byte(r, size, rex);
+  unsigned long *p = &regs[r - hb * REG_ESP];
+
+  *p = (*p & ~(write_mask[size] << (hb * 8))) | ((val & size_mask[size]) << (hb * 8));
+}
+
+// whole 8-byte accesses masked to size, the shadow has SHADOW_SLACK bytes past hi
+static inline unsigned long read_mem(const unsigned char *p, int size)
+{
+  unsigned long val;
+
+  memcpy(&val, p, sizeof(val));
+  return(val & size_mask[size]);
+}
+
+static inline void write_mem(unsigned char *p, int size, unsigned long val)
+{
+  unsigned long old;
+
+  memcpy(&old, p, sizeof(old));
+  old = (old & ~size_mask[size]) | (val & size_mask[size]);
+  memcpy(p, &old, sizeof(old));
+}
+
+/*
+ * data offset of a memory operand: every base holds the data pointer and
+ * the index register its initial value.  IR displacements are byte
+ * offsets, EVEX disp8 compression is the encoder's business.
+ */
+static inline long ir_disp(const insn_ir_t *ir, int i)
+{
+  int index = ir->index[i];
+  long scaled = (index == NO_INDEX) ? 0 : (long)ir->init_regs[index] << ir->scale[i];
+
+  return((ir->disp[i] & disp_mask[ir->disp_type[i] >> MODRM_SHIFT]) + scaled);
+}
+
+int golden_prepare(golden_t *g, const insn_ir_t *ir, volatile char *data, long data_bytes)
+{
+  long lo = 0, hi = 0;
+  int i;
+
+  // pass 1: the data range the test can touch, every base register is rdi
+  for (i = 0; i < ir->count; i++)
+  {
+    if (golden_ops[ir->type[i]].is_mem)
+    {
+      long off = ir_disp(ir, i);
+      long bytes = ir->size[i] << golden_ops[ir->type[i]].wide;
+
+      if (hi == 0 || off < lo)
+      {
+        lo = off;
+      }
+      if (off + bytes > hi)
+      {
+        hi = off + bytes;
+      }
+    }
+  }
+
+  // a wild displacement: snapshotting it would fault here instead of in the test
+  if (lo < 0 || hi > data_bytes)
+  {
+    return(GOLDEN_UNCHECKED);
+  }
+
+  if (hi - lo + SHADOW_SLACK > g->shadow_cap)
+  {
+    free(g->shadow);
+    g->shadow_cap = hi - lo + SHADOW_SLACK;
+    if ((g->shadow = malloc(g->shadow_cap)) == NULL)
+    {
+      g->shadow_cap = 0;
+      return(-1);
+    }
+  }
+
+  g->lo = lo;
+  g->hi = hi;
+  memcpy(g->shadow, (const void *)(data + lo), hi - lo);
+
+  g->ir = ir;
+
+  return(0);
+}
+
+/*
+ * Function: golden_cmpxchg
+ *
+ * Description:
+ *    cmpxchg compares the accumulator with mem: equal stores src, else
+ *    loads the accumulator.  cmpxchg8b/16b (wide) do the same with the
+ *    rdx:rax pair against the memory pair, storing rcx:rbx.  Only the
+ *    failing side writes registers, so a 32-bit accumulator is only zero
+ *    extended then.
+ */
+static void golden_cmpxchg(unsigned long *regs, unsigned char *addr, int size, int wide, unsigned long s)
+{
+  unsigned long lo = read_mem(addr, size);
+  unsigned long hi = wide ? read_mem(addr + size, size) : 0;
+  int eq = (lo == read_reg(regs, REG_EAX, size, 0)) && (!wide || hi == read_reg(regs, REG_EDX, size, 0));
+
+  if (!eq)
+  {
+    write_reg(regs, REG_EAX, size, 0, lo);
+    if (wide)
+    {
+      write_reg(regs, REG_EDX, size, 0, hi);
+    }
+    return;
+  }
+
+  if (wide)
+  {
+    write_mem(addr, size, read_reg(regs, REG_EBX, size, 0));
+    write_mem(addr + size, size, read_reg(regs, REG_ECX, size, 0));
+  }
+  else
+  {
+    write_mem(addr, size, s);
+  }
+}
+
+/*
+ * Function: golden_vec
+ *
+ * Description:
+ *    vector load or store of width bytes.  VEX and EVEX loads zero the
+ *    register above their width, a legacy SSE (xmm) load leaves it alone.
+ */
+static void golden_vec(unsigned char (*vregs)[VSZ_64], unsigned char *addr, int width, int vec, int vreg)
+{
+  unsigned char *v = vregs[vreg];
+
+  if (vec == VEC_STORE)
+  {
+    memcpy(addr, v, width);
+    return;
+  }
+
+  memcpy(v, addr, width);
+  if (width > VSZ_16)
+  {
+    memset(v + width, 0, VSZ_64 - width);
+  }
+}
+
+// pass 2: run the IR over the shadow, rsp is whatever the frame had
+static void golden_interpret(golden_t *g, volatile char *data, unsigned long rsp)
+{
+  const insn_ir_t *ir = g->ir;
+  unsigned long regs[NUM_GPRS + 1];
+  unsigned char vregs[NUM_VREGS][VSZ_64];
+  unsigned char scratch[sizeof(long)];
+  unsigned char *mem;
+  int i;
+
+  memcpy(regs, ir->init_regs, sizeof(g->regs));
+  regs[REG_ESP] = rsp;
+  for (int r = 0; r < NUM_GPRS; r++)
+  {
+    if (BASE_REGS & (1 << r))
+    {
+      regs[r] = (unsigned long)data;
+    }
+  }
+
+  // the preamble zeroes the vector registers
+  memset(vregs, 0, sizeof(vregs));
+
+  // shadow byte for data offset 0, memory ops index it with their displacement
+  mem = g->shadow - g->lo;
+
+  // a looped body counts LOOP_REG down from init_regs, which the body may read
+  for (int n = ir->loops ? ir->loops : 1; n > 0; n--)
+  {
+    for (i = 0; i < ir->count; i++)
+    {
+      const golden_op_t *op = &golden_ops[ir->type[i]];
+
+      if (op->vec)
+      {
+        golden_vec(vregs, mem + ir_disp(ir, i), ir->size[i], op->vec,
+                   (op->vec == VEC_STORE) ? ir->src[i] : ir->dest[i]);
+        continue;
+      }
+
+      int size = ir->size[i];
+      int src = ir->src[i];
+      int dest = ir->dest[i];
+      int rex = ((src | dest | ir->index[i]) & 0x8) != 0;
+      unsigned char *addr = op->is_mem ? mem + ir_disp(ir, i) : scratch;
+      unsigned long s = read_reg(regs, src, size, rex);
+      unsigned long m = read_mem(addr, size);
+      unsigned long in[3] = { [Y_SRC] = s, [Y_IMM] = ir->imm[i], [Y_MEM] = m };
+      unsigned long x = op->x_sel == X_DEST ? read_reg(regs, dest, size, rex) : m;
+      unsigned long y = in[op->y_sel];
+      unsigned long res[6] = { y, x + y, x - y, x & y, x | y, x ^ y };
+      int out[3] = { [OUT_NONE] = SCRATCH_REG, [OUT_DEST] = dest, [OUT_SRC] = src };
+      unsigned long reg_val[3] = { 0, res[op->fn], m };
+
+      if (op->cmpxchg)
+      {
+        golden_cmpxchg(regs, addr, size, op->wide, s);
+        continue;
+      }
+
+      write_mem(addr, size, op->mem_res ? res[op->fn] : m);
+      write_reg(regs, out[op->reg_out], size, rex, reg_val[op->reg_out]);
+    }
+
+    if (ir->loops)
+    {
+      regs[LOOP_REG]--;
+    }
+  }
+
+  memcpy(g->regs, regs, sizeof(g->regs));
+}
+
+int golden_check(golden_t *g, const unsigned long *regs, volatile char *data, int thread_id)
+{
+  static const char *reg_names[] =
+  {
+    "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+    "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"
+  };
+
+  golden_interpret(g, data, regs[REG_ESP]);
+
+  for (int r = 0; r < NUM_GPRS; r++)
+  {
+    if ((CHECKED_REGS & (1 << r)) && regs[r] != g->regs[r])
+    {
+      fprintf(stderr, "T%d golden mismatch: %s = 0x%lx, expected 0x%lx\n",
+              thread_id, reg_names[r], regs[r], g->regs[r]);
+      return(1);
+    }
+  }
+
+  if (g->hi > g->lo && memcmp(g->shadow, (const void *)(data + g->lo), g->hi - g->lo) != 0)
+  {
+    for (long off = g->lo; off < g->hi; off++)
+    {
+      if ((unsigned char)data[off] != g->shadow[off - g->lo])
+      {
+        fprintf(stderr, "T%d golden mismatch: data[0x%lx] = 0x%02x, expected 0x%02x\n",
+                thread_id, off, (unsigned char)data[off], g->shadow[off - g->lo]);
+        break;
+      }
+    }
+    return(1);
+  }
+
+  return(0);
+}
+
+void golden_free(golden_t *g)
+{
+  free(g->shadow);
+  g->shadow = NULL;
+  g->shadow_cap = 0;
+}
@@ -0,0 +1,148 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ *
+ * Seed sweep campaigns
+ *
+ * -S start:count runs every seed in the range the way encodeit -s seed
+ * would, inside one process: groups of -t pinned workers each take a seed,
+ * run its -i test cases per thread from zeroed data, and move on to the
+ * next.  Seeds are handed out by range: the count is cut into one
+ * contiguous batch per group, a group takes seeds from the front of its
+ * own batch and, once that is empty, steals the back half of the largest
+ * batch left.  Both ends of a batch live in one word, so taking and
+ * stealing are a single compare-and-swap each.
+ *
+ * Results go to a file with one fixed-size record per seed, at the seed's
+ * slot after the header:
+ *
+ *    0            campaign_hdr_t, the settings every seed ran with
+ *    64 + 80*k    campaign_rec_t of seed start + k
+ *
+ * The file is mapped shared and a record's CAMP_DONE flag is stored last,
+ * so it doubles as the checkpoint: after an interrupt (SIGINT/SIGTERM
+ * finish the seeds in flight, a kill loses them) the same command line
+ * resumes with the seeds that have no record yet.  A file written with
+ * different settings is refused rather than mixed into.
+ */
+
+#ifndef CAMPAIGN_H
+#define CAMPAIGN_H
+
+#include "perfctr.h"
+
+#define CAMPAIGN_MAGIC    0x4e474941504d4143UL   // "CAMPAIGN"
+#define CAMPAIGN_VERSION  1
+#define CAMPAIGN_REC_OFF  64
+#define CAMPAIGN_SYNC     4096          // seeds a group commits between msync()s
+
+// campaign_rec_t flags
+#define CAMP_DONE         0x01
+#define CAMP_FAILED       0x02          // a test case failed the golden check or faulted
+#define CAMP_FAULTED      0x04
+#define CAMP_DIVERGED     0x08          // -U: a thread's signature differs from thread 0's
+
+typedef struct
+{
+  unsigned long magic;
+  int version;
+  int start;                  // first seed
+  int count;                  // seeds in the campaign
+  int nthreads;               // threads per seed
+  int iterations;             // test cases per thread and seed
+  int num_inst;
+  long data_bytes;
+  int vec_width;
+  int golden;
+  int uniform;
+  int barrier;
+  unsigned long settings;     // hash of the -M mix, -D hot set and -k loop
+} campaign_hdr_t;
+
+typedef struct
+{
+  int seed;
+  unsigned short flags;
+  unsigned short valid;       // perfctr_counts_t.valid of every thread
+  int fails;                  // test cases, all threads
+  int faults;
+  unsigned long sig;          // thread 0's chained signature, the others' hashed onto it
+  unsigned long tsc;          // inside the generated code, all threads
+  unsigned long count[PC_NUM];
+} campaign_rec_t;
+
+// shared between the groups, forked or not
+typedef struct
+{
+  volatile int stop;          // interrupted, take no more seeds
+  volatile int ngroups;
+  struct
+  {
+    volatile unsigned long range;     // next seed index | end << 32
+    volatile long commits;
+  } __attribute__((aligned(64))) queue[];
+} campaign_sched_t;
+
+typedef struct
+{
+  int fd;
+  long len;
+  campaign_hdr_t *hdr;        // the mapped file
+  campaign_rec_t *rec;        // hdr->count records
+  campaign_sched_t *sched;
+  long sched_len;
+  long resumed;               // seeds already done when the file was opened
+} campaign_t;
+
+/*
+ * Function: campaign_open
+ *
+ * Description:
+ *    creates the results file, or reopens one left by the same campaign,
+ *    and splits the seeds into one batch per group
+ *
+ * Inputs:
+ *    campaign_t *c                :  campaign state
+ *    const char *path             :  results file
+ *    const campaign_hdr_t *info   :  settings, magic/version are filled in
+ *    int ngroups                  :  worker groups taking seeds
+ *
+ * Output:
+ *    0 on success, -1 on an I/O error or a file from another campaign
+ *    (reported on stderr)
+ */
+int campaign_open(campaign_t *c, const char *path, const campaign_hdr_t *info, int ngroups);
+
+/*
+ * Function: campaign_next
+ *
+ * Description:
+ *    next seed for group g, from its own batch or stolen from the largest
+ *    other one.  Seeds that have a record from an earlier run are skipped.
+ *
+ * Output:
+ *    the seed, -1 when the campaign is over or interrupted
+ */
+int campaign_next(campaign_t *c, int g);
+
+/*
+ * Function: campaign_commit
+ *
+ * Description:
+ *    publishes a finished seed's record, flags last, and every
+ *    CAMPAIGN_SYNC of group g's seeds flushes the file
+ */
+void campaign_commit(campaign_t *c, int g, const campaign_rec_t *r);
+
+// SIGINT/SIGTERM stop c taking new seeds, the seeds in flight finish
+void campaign_catch_interrupt(campaign_t *c);
+
+void campaign_close(campaign_t *c);
+
+static inline campaign_rec_t *campaign_rec(const campaign_t *c, int seed)
+{
+  return(&c->rec[seed - c->hdr->start]);
+}
+
+#endif
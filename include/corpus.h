@@ -0,0 +1,133 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ *
+ * Test corpus files
+ *
+ * A corpus file holds one multi-threaded test case: for every thread the
+ * encoded code, the IR it was encoded from and the data image it started
+ * with, plus what's needed to run it the same way again (thread count,
+ * the CPUs the threads ran on, the -p/-C placement, vector width).  The
+ * code sections start on page boundaries and are whole pages, so a replay
+ * maps the file once, makes them executable in place and calls them
+ * straight from the mapping.  The IR and data sections are only 64-byte
+ * aligned; the golden model reads the IR from the mapping as it is, and
+ * only the data images are copied, into the buffers the test cases write.
+ *
+ *    page 0..     corpus_hdr_t, then nthreads corpus_thread_t
+ *    code         code_bytes per thread (whole pages), entry point at the start
+ *    ir           IR_BYTES(count) per thread, the ir_carve() layout, 64-byte aligned
+ *    data         data_bytes per thread, a single image with -D
+ *
+ * The code calls the preamble/postamble and ctx layout of the build that
+ * wrote it; CORPUS_VERSION changes whenever those or the header do.
+ */
+
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <string.h>
+
+#include "insn_ir.h"
+
+#define CORPUS_MAGIC    0x5355505230434e45UL   // "ENC0RPUS"
+#define CORPUS_VERSION  3
+#define CORPUS_POLICY   32
+
+typedef struct
+{
+  int cpu;                    // CPU the thread ran on
+  int iteration;              // test case number in the run that wrote it
+  int count;                  // instructions
+  int loops;                  // insn_ir_t.loops, the same for every thread
+  unsigned long sig;          // test_signature() of the original run, 0 if not reproducible
+  unsigned long init_regs[NUM_GPRS];
+  long code_off;              // file offsets of the thread's sections
+  long ir_off;
+  long data_off;
+} corpus_thread_t;
+
+typedef struct
+{
+  unsigned long magic;
+  int version;
+  int nthreads;
+  int seed;
+  int vec_width;              // widest vector access, the CPU must have it
+  long code_bytes;            // per thread
+  long data_bytes;            // per image
+  int shared_data;            // -D: one image for every thread
+  int golden;                 // the golden model applies
+  int barrier;                // the code has start/end barriers
+  int loop_barrier;           // and one at the top of every loop iteration
+  char placement[CORPUS_POLICY];    // -C list or -p policy the run used
+  corpus_thread_t thread[];
+} corpus_hdr_t;
+
+// one thread's test case, as corpus_write() takes it
+typedef struct
+{
+  const insn_ir_t *ir;
+  const volatile char *code;  // code_bytes of encoded test case
+  const volatile char *data;  // data_bytes image before it ran
+  int cpu;
+  int iteration;
+  unsigned long sig;
+} corpus_test_t;
+
+typedef struct
+{
+  char *map;
+  long len;
+  const corpus_hdr_t *hdr;
+} corpus_t;
+
+/*
+ * Function: corpus_write
+ *
+ * Inputs:
+ *    const char *path             :  file to create
+ *    const corpus_hdr_t *info     :  header fields, magic/version/offsets are filled in
+ *    const corpus_test_t *tests   :  info->nthreads test cases
+ *
+ * Output:
+ *    0 on success, -1 on an I/O error (reported on stderr)
+ */
+int corpus_write(const char *path, const corpus_hdr_t *info, const corpus_test_t *tests);
+
+/*
+ * Function: corpus_open
+ *
+ * Description:
+ *    maps a corpus file read-only and its code sections read/execute
+ *
+ * Output:
+ *    0 on success, -1 on a missing, short or foreign file (reported on stderr)
+ */
+int corpus_open(corpus_t *c, const char *path);
+
+void corpus_close(corpus_t *c);
+
+// thread t's IR, pointing into the mapping
+static inline void corpus_ir(const corpus_t *c, int t, insn_ir_t *ir)
+{
+  const corpus_thread_t *ct = &c->hdr->thread[t];
+
+  ir_carve(ir, c->map + ct->ir_off, ct->count);
+  ir->count = ct->count;
+  ir->loops = ct->loops;
+  memcpy(ir->init_regs, ct->init_regs, sizeof(ir->init_regs));
+}
+
+static inline const volatile char *corpus_code(const corpus_t *c, int t)
+{
+  return(c->map + c->hdr->thread[t].code_off);
+}
+
+static inline const volatile char *corpus_data(const corpus_t *c, int t)
+{
+  return(c->map + c->hdr->thread[t].data_off);
+}
+
+#endif
@@ -0,0 +1,117 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ *
+ * Binary event log
+ *
+ * Each thread appends fixed-size records to its own ring in a shared
+ * mapping; nothing is formatted or written while a test runs.  The parent
+ * renders the rings as text into the -l logfile after the children exit.
+ * When a ring wraps the oldest records are overwritten and counted as
+ * dropped.
+ */
+
+#ifndef EVLOG_H
+#define EVLOG_H
+
+#include <x86intrin.h>
+
+#include "ia32_encode.h"
+
+#define EVLOG_RECORDS    (1 << 16)    // records per thread, power of 2
+
+// record kinds beyond the instruction types (REG2REG..)
+#define EV_TEST_BEGIN    0xf0         // generation of a test case starts
+#define EV_EXEC_BEGIN    0xf1         // executeit() entered
+#define EV_EXEC_END      0xf2         // executeit() returned, imm = rc
+#define EV_SIGNATURE     0xf3         // test case signature, imm = signature
+#define EV_FAULT         0xf4         // generated code faulted, see evlog_fault()
+
+typedef struct
+{
+  unsigned long  tsc;         // rdtsc when the record was written
+  long           imm;         // immediate, or event payload
+  int            disp;
+  unsigned int   code_off;    // offset into mptr_threads[i]
+  unsigned int   iteration;
+  unsigned char  type;        // instruction type or EV_*
+  unsigned char  size;
+  unsigned char  regs;        // src << 4 | dest
+  unsigned char  flags;       // disp_type >> MODRM_SHIFT | lock << 2
+  unsigned char  sib;         // scale << 4 | index, NO_INDEX for none
+} evlog_rec_t;
+
+typedef struct
+{
+  volatile unsigned long head;    // records ever written
+  unsigned long pad[7];           // keep the records off the head's line
+  evlog_rec_t rec[EVLOG_RECORDS];
+} evlog_t;
+
+static inline evlog_rec_t *evlog_next(evlog_t *log)
+{
+  return(&log->rec[log->head++ & (EVLOG_RECORDS - 1)]);
+}
+
+/*
+ * Function: evlog_event
+ *
+ * Description:
+ *    append a non-instruction event (EV_*) to the ring
+ */
+static inline void evlog_event(evlog_t *log, int kind, unsigned int iteration, long payload)
+{
+  evlog_rec_t *r = evlog_next(log);
+
+  r->tsc = __rdtsc();
+  r->imm = payload;
+  r->disp = 0;
+  r->code_off = 0;
+  r->iteration = iteration;
+  r->type = kind;
+  r->size = 0;
+  r->regs = 0;
+  r->flags = 0;
+  r->sib = NO_INDEX;
+}
+
+/*
+ * Function: evlog_fault
+ *
+ * Description:
+ *    append a recovered fault: code_off is the faulting rip's offset into
+ *    the test case, size the signal and imm the faulting address
+ */
+static inline void evlog_fault(evlog_t *log, unsigned int iteration, long off, int signo, unsigned long addr)
+{
+  evlog_event(log, EV_FAULT, iteration, addr);
+  log->rec[(log->head - 1) & (EVLOG_RECORDS - 1)].code_off = off;
+  log->rec[(log->head - 1) & (EVLOG_RECORDS - 1)].size = signo;
+}
+
+/*
+ * Function: evlog_insn
+ *
+ * Description:
+ *    append one generated instruction to the ring
+ */
+static inline void evlog_insn(evlog_t *log, unsigned int iteration, unsigned int code_off,
+                              int type, int size, int src, int dest, int disp_type, int index,
+                              int scale, int disp, long imm, int lock)
+{
+  evlog_rec_t *r = evlog_next(log);
+
+  r->tsc = __rdtsc();
+  r->imm = imm;
+  r->disp = disp;
+  r->code_off = code_off;
+  r->iteration = iteration;
+  r->type = type;
+  r->size = size;
+  r->regs = (src << 4) | (dest & 0xf);
+  r->flags = ((disp_type >> 6) & 0x3) | (lock << 2);
+  r->sib = (scale << 4) | index;
+}
+
+#endif
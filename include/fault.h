@@ -0,0 +1,75 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ *
+ * Fault recovery
+ *
+ * Generated code that faults (SIGSEGV, SIGILL, SIGBUS) doesn't take its
+ * worker down.  Each thread that runs test cases calls fault_init_thread()
+ * for its own alternate signal stack; the handlers are shared.  Around the
+ * call into a test case the caller arms a sigjmp_buf:
+ *
+ *    sigjmp_buf jb;
+ *
+ *    if (sigsetjmp(jb, 0) == 0)
+ *    {
+ *      fault_arm(&jb);
+ *      ... call the test case ...
+ *      fault_disarm();
+ *    }
+ *    else
+ *    {
+ *      ... fault_last says what happened ...
+ *    }
+ *
+ * The handler records the signal and the faulting RIP in fault_last and
+ * siglongjmps back.  It runs with SA_NODEFER and an empty sa_mask, so
+ * nothing was blocked on the way in and the mask needn't be saved: that
+ * would be a sigprocmask call around every test case.  A fault while
+ * nothing is armed is a bug in encodeit itself: the default action is
+ * restored and the instruction faults again, fatally.
+ */
+
+#ifndef FAULT_H
+#define FAULT_H
+
+#include <setjmp.h>
+
+#define FAULT_STACK   (64 * 1024)
+
+typedef struct
+{
+  int signo;
+  int code;                   // si_code, e.g. SEGV_MAPERR
+  unsigned long rip;          // faulting instruction
+  unsigned long addr;         // si_addr: the bad address, or rip for SIGILL
+  unsigned long r15;          // loop counter of a looped body, iterations left including this one
+} fault_t;
+
+extern __thread sigjmp_buf *fault_jmp;
+extern __thread fault_t fault_last;
+
+/*
+ * Function: fault_init_thread
+ *
+ * Description:
+ *    gives the calling thread an alternate signal stack (a fault with a
+ *    wrecked rsp still gets handled) and installs the handlers
+ *
+ * Output:
+ *    0 on success, -1 on failure (reported on stderr)
+ */
+int fault_init_thread(void);
+
+static inline void fault_arm(sigjmp_buf *jb)
+{
+  fault_jmp = jb;
+}
+
+static inline void fault_disarm(void)
+{
+  fault_jmp = NULL;
+}
+
+#endif
@@ -0,0 +1,150 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ *
+ * Test case generation
+ *
+ * generate_instructions() makes the random choices for a test case into
+ * the IR, build_instructions() does that and encodes the result into a
+ * code buffer between the preamble and postamble.  The generated code is
+ * called as test(data, ctx) with the layouts below.
+ *
+ * Kept apart from the driver so the benchmarks can build test cases
+ * without forking workers.
+ */
+
+#ifndef GENERATE_H
+#define GENERATE_H
+
+#include "ia32_encode.h"
+#include "rng.h"
+#include "insn_ir.h"
+#include "profile.h"
+
+// shared spin barrier the generated code synchronizes on, count and sense on their own lines
+typedef struct
+{
+  volatile int count __attribute__((aligned(64)));
+  volatile int sense __attribute__((aligned(64)));
+} barrier_t;
+
+// per-thread context, passed to the generated code as its second argument
+typedef struct
+{
+  barrier_t *barrier;         // shared barrier
+  volatile int sense;         // this thread's barrier sense, flipped at every barrier
+  int nthreads;               // threads taking part in the barrier
+  unsigned long regs[NUM_GPRS];   // registers captured by the postamble
+} __attribute__((aligned(64))) thread_ctx_t;
+
+// generator settings, filled in from the command line before any worker starts
+typedef struct
+{
+  long data_bytes;            // displacements stay inside a buffer this size
+  int use_barrier;            // emit the start/end spin barriers
+  int uniform;                // keep rsp/rdi out of the sources (-U)
+  int quiet;                  // no per test case messages
+  const profile_t *profile;   // -M weighted mix, NULL for the uniform draws
+  int vec_width;              // widest vector load/store generated, VSZ_16/32/64
+  int avx;                    // CPU has AVX: vzeroall/vzeroupper around the body
+
+  // -k: run the body loop_count times in a counted loop, see encode_test()
+  int loop_count;             // 0 for no loop
+  int loop_barrier;           // spin barrier at the top of every iteration
+
+  // -D: one data region shared by every thread, see gen_shared_init()
+  int shared_data;
+  int hot_lines;              // cache lines in the hot set, at the start of the region
+  int hot_pct;                // percentage of memory accesses that go to the hot set
+  int false_sharing;          // each thread keeps to its own bytes of a hot line
+  int slot_bytes;             // false sharing: bytes of each hot line per thread
+  long cold_bytes;            // per-thread private slice after the hot set
+} gen_config_t;
+
+#define LINE_BYTES     64
+
+/*
+ * Function: barrier_arrive
+ *
+ * Description:
+ *    one arrival at the barrier, the same protocol add_barrier() emits.
+ *    A thread whose test case faulted still owes the end barrier; this
+ *    pays it so the other threads aren't left spinning.
+ */
+static inline void barrier_arrive(thread_ctx_t *ctx)
+{
+  int sense = ctx->sense ^ 1;
+
+  ctx->sense = sense;
+  if (__atomic_add_fetch(&ctx->barrier->count, 1, __ATOMIC_SEQ_CST) == ctx->nthreads)
+  {
+    ctx->barrier->count = 0;
+    __atomic_store_n(&ctx->barrier->sense, sense, __ATOMIC_RELEASE);
+  }
+  else
+  {
+    while (__atomic_load_n(&ctx->barrier->sense, __ATOMIC_ACQUIRE) != sense)
+    {
+      __builtin_ia32_pause();
+    }
+  }
+}
+
+extern gen_config_t gen_cfg;
+
+/*
+ * Function: gen_shared_init
+ *
+ * Description:
+ *    lays out the shared data region for -D: hot_lines lines at offset 0
+ *    that every thread hits hot_pct% of the time, then one private slice
+ *    per thread for the rest.  With true sharing threads pick any aligned
+ *    bytes of a hot line; with false sharing every line is split into
+ *    per-thread slots and operands are narrowed to fit a slot.
+ *
+ * Inputs:
+ *    int nthreads             :  threads sharing the region
+ *
+ * Output:
+ *    0 on success, -1 if the hot set doesn't fit (reported on stderr)
+ */
+int gen_shared_init(int nthreads);
+
+/*
+ * Function: gen_vec_init
+ *
+ * Description:
+ *    caps the generated vector width at what the CPU and OS support:
+ *    xmm always, ymm with AVX, zmm with AVX-512F
+ *
+ * Inputs:
+ *    int max_width            :  requested cap, VSZ_16/32/64
+ *
+ * Output:
+ *    the width in effect
+ */
+int gen_vec_init(int max_width);
+
+/*
+ * Function: gen_preamble / gen_postamble / gen_barrier
+ *
+ * Description:
+ *    the test case frame and spin barrier, for code that isn't a random
+ *    body (litmus tests).  The preamble saves the callee-saved registers,
+ *    keeps ctx in rsi and takes the start barrier; the postamble captures
+ *    the registers, takes the end barrier and returns.  gen_barrier()
+ *    expects ctx in rsi and clobbers rax/rcx/rdx.
+ */
+volatile char *gen_preamble(volatile char *tgt_addr);
+volatile char *gen_postamble(volatile char *tgt_addr);
+volatile char *gen_barrier(volatile char *tgt_addr);
+
+int generate_instructions(insn_ir_t *ir, int num_to_build, int thread_id, rng_t *rng);
+
+// encode an existing IR between the preamble and postamble, see generate.c
+volatile char *encode_test(volatile char *next_ptr, long code_bytes, insn_ir_t *ir);
+
+int build_instructions(volatile char *next_ptr, long code_bytes, int thread_id, int num_to_build, rng_t *rng, insn_ir_t *ir);
+
+#endif
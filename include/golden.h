@@ -0,0 +1,82 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ *
+ * Software golden model
+ *
+ * Interprets a test case's IR to predict the final register and data
+ * state.  golden_prepare() is called after the test is built and before
+ * it executes: it snapshots the part of the data buffer the test can
+ * touch.  golden_check() then runs the IR over that shadow copy and
+ * compares the registers the postamble captured and the real data buffer
+ * against the prediction.  Interpretation waits until after the run
+ * because the body may read rsp, whose value only the postamble knows.
+ *
+ * Only valid when nothing else writes the thread's data buffer while the
+ * test runs, i.e. single threaded runs or thread-private data regions.
+ */
+
+#ifndef GOLDEN_H
+#define GOLDEN_H
+
+#include "insn_ir.h"
+
+// registers the preamble initializes and the postamble captures (all but rsp)
+#define CHECKED_REGS ((1 << NUM_GPRS) - 1 - (1 << REG_ESP))
+
+// memory operand bases, the preamble points them all at the data buffer
+#define BASE_REGS    ((1 << REG_EDI) | (1 << REG_R12) | (1 << REG_R13))
+
+// SIB index register, loaded with INDEX_VALUE; it and the bases are never written
+#define INDEX_REG    REG_R14
+#define INDEX_VALUE  64
+
+// counter of the loop around a looped body (insn_ir_t.loops), which then never writes it
+#define LOOP_REG     REG_R15
+
+// golden_prepare(): the test case reaches outside the data buffer, don't check it
+#define GOLDEN_UNCHECKED 1
+
+typedef struct
+{
+  unsigned long regs[NUM_GPRS];   // predicted final registers
+  long lo, hi;                    // touched range, offsets into the data buffer
+  unsigned char *shadow;          // predicted bytes for [lo, hi)
+  long shadow_cap;
+  const insn_ir_t *ir;            // test case being checked
+} golden_t;
+
+/*
+ * Function: golden_prepare
+ *
+ * Inputs:
+ *    golden_t *g                  :  model state, shadow grows as needed
+ *    const insn_ir_t *ir          :  test case (init_regs and instructions), kept until the check
+ *    volatile char *data          :  thread's data buffer before execution
+ *    long data_bytes              :  its size
+ *
+ * Output:
+ *    0 on success, GOLDEN_UNCHECKED if an operand lies outside the buffer
+ *    (the test is expected to fault, nothing was read), -1 if the shadow
+ *    couldn't be allocated
+ */
+int golden_prepare(golden_t *g, const insn_ir_t *ir, volatile char *data, long data_bytes);
+
+/*
+ * Function: golden_check
+ *
+ * Inputs:
+ *    golden_t *g                  :  snapshot from golden_prepare()
+ *    const unsigned long *regs    :  registers captured at the end of the test, rsp included
+ *    volatile char *data          :  thread's data buffer after execution
+ *    int thread_id                :  for the mismatch report
+ *
+ * Output:
+ *    0 on match, 1 on mismatch (first difference reported on stderr)
+ */
+int golden_check(golden_t *g, const unsigned long *regs, volatile char *data, int thread_id);
+
+void golden_free(golden_t *g);
+
+#endif
@@ -5,17 +5,20 @@
  *
  * GENERAL Instruction Format
  *
- * -----------------------------------------------------------------
- * | Instruction    |   Opcode | ModR/M | Displacement | Immediate |
- * | Prefix         |          |        |              |           |
- * -----------------------------------------------------------------
- *
- *  7  6  5   3  2   0
- * --------------------
- * | Mod | Reg* | R/M |
- * --------------------
+ * -----------------------------------------------------------------------
+ * | Instruction    |   Opcode | ModR/M | SIB | Displacement | Immediate |
+ * | Prefix         |          |        |     |              |           |
+ * -----------------------------------------------------------------------
+ *
+ *  7  6  5   3  2   0        7     6  5     3  2    0
+ * --------------------       ------------------------
+ * | Mod | Reg* | R/M |       | Scale | Index | Base |
+ * --------------------       ------------------------
  */
 
+#ifndef IA32_ENCODE_H
+#define IA32_ENCODE_H
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/mman.h>
@@ -35,9 +38,32 @@
 #define MFENCE      6
 #define LFENCE      7
 #define SFENCE      8
-
-// ~largest encodable instruction + postamble
-#define SAFETY_MARGIN    32
+#define ADD2MEM     9       // ALU op [mem], reg, lockable
+#define SUB2MEM     10
+#define AND2MEM     11
+#define OR2MEM      12
+#define XOR2MEM     13
+#define ADD2REG     14      // ALU op reg, [mem]
+#define SUB2REG     15
+#define AND2REG     16
+#define OR2REG      17
+#define XOR2REG     18
+#define INCMEM      19      // inc/dec [mem], lockable
+#define DECMEM      20
+#define CMPXCHG     21      // cmpxchg [mem], reg, lockable
+#define CMPXCHGB    22      // cmpxchg8b (size 4) / cmpxchg16b (size 8) [mem], lockable
+#define VLOADU      23      // vector load, movdqu / vmovdqu / vmovdqu64
+#define VLOADA      24      // aligned vector load, movdqa / vmovdqa / vmovdqa64
+#define VSTOREU     25      // vector store, unaligned
+#define VSTOREA     26      // vector store, aligned
+#define VSTORENT    27      // non-temporal vector store, movntdq / vmovntdq, aligned
+#define NUM_TYPES   (VSTORENT + 1)
+
+#define VEC_FIRST   VLOADU
+#define IS_VEC(t)   ((t) >= VEC_FIRST)
+
+// ~largest encodable instruction + encoder store slack + postamble
+#define SAFETY_MARGIN    48
 
 /*
  * definitions we need to support these functions.
@@ -66,15 +92,18 @@
 #define REG_ESI        0x6
 #define REG_EDI        0x7
 
-// register defs based for x86_64, requires REX extension
-#define REG_R8        0x0
-#define REG_R9        0x1
-#define REG_R10       0x2
-#define REG_R11       0x3
-#define REG_R12       0x4
-#define REG_R13       0x5
-#define REG_R14       0x6
-#define REG_R15       0x7
+// register defs based for x86_64, bit 3 goes in REX.R/X/B
+#define REG_R8        0x8
+#define REG_R9        0x9
+#define REG_R10       0xa
+#define REG_R11       0xb
+#define REG_R12       0xc
+#define REG_R13       0xd
+#define REG_R14       0xe
+#define REG_R15       0xf
+
+// SIB index field of rsp means no index
+#define NO_INDEX       REG_ESP
 
 // byte offset
 #define BYTE1_OFF      0x1
@@ -90,6 +119,12 @@
 #define ISZ_4         0x4
 #define ISZ_8         0x8
 
+// vector widths: xmm (SSE), ymm (VEX.256), zmm (EVEX.512)
+#define VSZ_16        0x10
+#define VSZ_32        0x20
+#define VSZ_64        0x40
+#define NUM_VREGS     8     // xmm0-7, no REX/VEX/EVEX register extension
+
 // x86_64 support defines
 #define PREFIX_16BIT  0x66
 #define PREFIX_LOCK   0xf0
@@ -99,16 +134,367 @@
 #define REX_X         0x2
 #define REX_B         0x1
 
-// code generation defines
-#define MAX_THREADS     4
-#define MAX_INSTR_BYTES (3 * PAGESIZE)      // allocate 3  PAGES for instruction
-#define MAX_DATA_BYTES  (10 * PAGESIZE)     // allocate 10 PAGES for data
+/*
+ * VEX/EVEX prefixes, see SDM 2.3 and 2.7.  The register extension bits
+ * (R, X, B, R', V') and vvvv are stored inverted, all ones here since
+ * the vector forms use xmm0-7 with an rdi base and no second source.
+ *
+ *   2-byte VEX   C5  [R vvvv L pp]
+ *   3-byte VEX   C4  [R X B m-mmmm]  [W vvvv L pp]
+ *   EVEX         62  [R X B R' 0 0 m m]  [W vvvv 1 pp]  [z L'L b V' aaa]
+ *
+ * Rows carry the 2-byte VEX form, encode_insn_sib() switches to the
+ * 3-byte one when a base or index register needs X or B.
+ */
+#define VEX2_PREFIX   0xc5
+#define VEX3_PREFIX   0xc4
+#define EVEX_PREFIX   0x62
+#define VEX_PP_NONE   0x0
+#define VEX_PP_66     0x1
+#define VEX_PP_F3     0x2
+#define VEX_PP_F2     0x3
+#define VEX_MAP_0F    0x1
+
+#define VEX2_BYTE(l, pp)        (0xf8 | (l) << 2 | (pp))
+#define EVEX_P0(map)            (0xf0 | (map))
+#define EVEX_P1(w, pp)          ((w) << 7 | 0x7c | (pp))
+#define EVEX_P2(ll)             ((ll) << 5 | 0x08)
+
+// code generation defines, per thread sizes can be overridden at runtime
+#define DEF_INSTR_BYTES (3 * PAGESIZE)      // allocate at least 3 PAGES for instruction
+#define DEF_DATA_BYTES  (10 * PAGESIZE)     // allocate 10 PAGES for data
+#define FRAME_BYTES     768                 // preamble + postamble (+ loop) budget
+
+#ifndef HUGE_PAGESIZE
+#define HUGE_PAGESIZE   (2 * 1024 * 1024)
+#endif
 
 // information sharing between tasks
 #define NUM_PTRS 2
 #define CODE 0
 #define DATA 1
 
+/*
+ * Table-driven encoder
+ *
+ * Every generated instruction is described by one enc_desc_t, indexed by
+ * instruction type (REG2REG..SFENCE above) and operand size.  The
+ * descriptor carries everything that used to be spread across the
+ * per-instruction size switches: operand size prefix, REX.W, opcode
+ * bytes, ModR/M form and immediate width.  encode_insn_sib() works out
+ * the exact length up front, assembles the bytes in registers and emits
+ * the whole instruction with two 8 byte stores: prefixes/REX/opcode/
+ * ModR/M/SIB, then displacement/immediate.  The REX (or VEX/EVEX) R, X
+ * and B bits come from the operands, so any operand can be r8-r15.
+ *
+ * Adding an opcode means adding a row to enc_table, not another switch.
+ */
+
+// ModR/M forms
+#define FORM_NONE      0    // opcode bytes only
+#define FORM_MODRM     1    // reg field is a register operand
+#define FORM_MODRM_EXT 2    // reg field is an opcode extension (/digit)
+#define FORM_OPREG     3    // register encoded in the low opcode bits
+
+#define NUM_SIZES      4    // 1/2/4/8 byte operands
+#define MAX_INSN_BYTES 15   // architectural instruction length limit
+#define ENC_STORE      16   // bytes written per encode_insn() call
+
+// VEX/EVEX forms, the prefix is part of head
+#define ENC_LEGACY     0
+#define ENC_VEX2       1
+#define ENC_EVEX       2
+
+typedef struct
+{
+  unsigned long head;       // prefix and opcode bytes, in order, without REX
+  unsigned char head_len;   // number of bytes in head
+  unsigned char form;       // FORM_*
+  unsigned char ext;        // /digit for FORM_MODRM_EXT
+  unsigned char imm_len;    // immediate bytes
+  unsigned char pfx_len;    // legacy prefix bytes ahead of the opcode, REX goes after them
+  unsigned char rex_w;      // 64-bit operand size
+  unsigned char vex;        // ENC_LEGACY/VEX2/EVEX
+  unsigned char disp8_shift;  // EVEX disp8*N compression, log2 N
+} enc_desc_t;
+
+// pack prefix/opcode bytes: byte operands, 16-bit (0x66), 32-bit, 64-bit (REX.W)
+#define ENC_B(o, f, x, i)          { (o), 1, f, x, i }
+#define ENC_W(o, f, x, i)          { PREFIX_16BIT | (o) << 8, 2, f, x, i, 1 }
+#define ENC_D(o, f, x, i)          { (o), 1, f, x, i }
+#define ENC_Q(o, f, x, i)          { (o), 1, f, x, i, 0, 1 }
+#define ENC2_B(o1, o2, f)          { (o1) | (o2) << 8, 2, f, 0, 0 }
+#define ENC2_W(o1, o2, f)          { PREFIX_16BIT | (o1) << 8 | (o2) << 16, 3, f, 0, 0, 1 }
+#define ENC2_D(o1, o2, f)          { (o1) | (o2) << 8, 2, f, 0, 0 }
+#define ENC2_Q(o1, o2, f)          { (o1) | (o2) << 8, 2, f, 0, 0, 0, 1 }
+#define ENC_FENCE(m)               { 0x0f | 0xae << 8 | (m) << 16, 3, FORM_NONE, 0, 0 }
+#define ENC_ALL(d)                 { d, d, d, d }
+#define ENC_NONE                   { 0, 0, 0, 0, 0 }
+
+/*
+ * Vector rows are indexed by width instead of operand size, VSZ_16/32/64
+ * in columns 1-3 (see enc_size_index), column 0 is unused.  The register
+ * operand is xmm/ymm/zmm 0-7.
+ *
+ *   xmm    legacy SSE, [66|F3] 0F op
+ *   ymm    VEX.256.[66|F3].0F op
+ *   zmm    EVEX.512.[66|F3].0F.W op, disp8 scaled by the 64 byte vector
+ */
+#define ENC_SSE(pp, o)             { (pp) | 0x0f << 8 | (o) << 16, 3, FORM_MODRM, 0, 0, 1 }
+#define ENC_VEX256(pp, o)          { VEX2_PREFIX | VEX2_BYTE(1, pp) << 8 | (o) << 16, 3, FORM_MODRM, 0, 0, \
+                                     0, 0, ENC_VEX2 }
+#define ENC_EVEX512(pp, w, o)      { EVEX_PREFIX | EVEX_P0(VEX_MAP_0F) << 8 | EVEX_P1(w, pp) << 16 | \
+                                     EVEX_P2(2) << 24 | (unsigned long)(o) << 32, 5, FORM_MODRM, 0, 0, \
+                                     0, 0, ENC_EVEX, 6 }
+#define ENC_VEC(p, pp, w, o)       { ENC_NONE, ENC_SSE(p, o), ENC_VEX256(pp, o), ENC_EVEX512(pp, w, o) }
+
+// classic ALU block: op r/m8, r8 at o, op r/m, r at o + 1 (+2 for the reg, r/m forms)
+#define ENC_ALU(o)                 { ENC_B(o, FORM_MODRM, 0, 0),     ENC_W((o) + 1, FORM_MODRM, 0, 0), \
+                                     ENC_D((o) + 1, FORM_MODRM, 0, 0), ENC_Q((o) + 1, FORM_MODRM, 0, 0) }
+#define ENC_INCDEC(x)              { ENC_B(0xfe, FORM_MODRM_EXT, x, 0), ENC_W(0xff, FORM_MODRM_EXT, x, 0), \
+                                     ENC_D(0xff, FORM_MODRM_EXT, x, 0), ENC_Q(0xff, FORM_MODRM_EXT, x, 0) }
+
+static const enc_desc_t enc_table[][NUM_SIZES] =
+{
+  [REG2REG] = { ENC_B(0x8a, FORM_MODRM, 0, 0),     ENC_W(0x8b, FORM_MODRM, 0, 0),
+                ENC_D(0x8b, FORM_MODRM, 0, 0),     ENC_Q(0x8b, FORM_MODRM, 0, 0) },
+  [IMM2REG] = { ENC_B(0xc6, FORM_MODRM_EXT, 0, 1), ENC_W(0xc7, FORM_MODRM_EXT, 0, 2),
+                ENC_D(0xc7, FORM_MODRM_EXT, 0, 4), ENC_Q(0xb8, FORM_OPREG, 0, 8) },
+  [REG2MEM] = { ENC_B(0x88, FORM_MODRM, 0, 0),     ENC_W(0x89, FORM_MODRM, 0, 0),
+                ENC_D(0x89, FORM_MODRM, 0, 0),     ENC_Q(0x89, FORM_MODRM, 0, 0) },
+  [MEM2REG] = { ENC_B(0x8a, FORM_MODRM, 0, 0),     ENC_W(0x8b, FORM_MODRM, 0, 0),
+                ENC_D(0x8b, FORM_MODRM, 0, 0),     ENC_Q(0x8b, FORM_MODRM, 0, 0) },
+  [XADD]    = { ENC2_B(0x0f, 0xc0, FORM_MODRM),    ENC2_W(0x0f, 0xc1, FORM_MODRM),
+                ENC2_D(0x0f, 0xc1, FORM_MODRM),    ENC2_Q(0x0f, 0xc1, FORM_MODRM) },
+  [XCHG]    = { ENC_B(0x86, FORM_MODRM, 0, 0),     ENC_W(0x87, FORM_MODRM, 0, 0),
+                ENC_D(0x87, FORM_MODRM, 0, 0),     ENC_Q(0x87, FORM_MODRM, 0, 0) },
+  [MFENCE]  = ENC_ALL(ENC_FENCE(0xf0)),
+  [LFENCE]  = ENC_ALL(ENC_FENCE(0xe8)),
+  [SFENCE]  = ENC_ALL(ENC_FENCE(0xf8)),
+  [ADD2MEM] = ENC_ALU(0x00),
+  [SUB2MEM] = ENC_ALU(0x28),
+  [AND2MEM] = ENC_ALU(0x20),
+  [OR2MEM]  = ENC_ALU(0x08),
+  [XOR2MEM] = ENC_ALU(0x30),
+  [ADD2REG] = ENC_ALU(0x02),
+  [SUB2REG] = ENC_ALU(0x2a),
+  [AND2REG] = ENC_ALU(0x22),
+  [OR2REG]  = ENC_ALU(0x0a),
+  [XOR2REG] = ENC_ALU(0x32),
+  [INCMEM]  = ENC_INCDEC(0),
+  [DECMEM]  = ENC_INCDEC(1),
+  [CMPXCHG] = { ENC2_B(0x0f, 0xb0, FORM_MODRM),    ENC2_W(0x0f, 0xb1, FORM_MODRM),
+                ENC2_D(0x0f, 0xb1, FORM_MODRM),    ENC2_Q(0x0f, 0xb1, FORM_MODRM) },
+  [CMPXCHGB] = { ENC_NONE, ENC_NONE,
+                 { 0x0f | 0xc7 << 8, 2, FORM_MODRM_EXT, 1, 0 },
+                 { 0x0f | 0xc7 << 8, 2, FORM_MODRM_EXT, 1, 0, 0, 1 } },
+  [VLOADU]   = ENC_VEC(0xf3, VEX_PP_F3, 1, 0x6f),
+  [VLOADA]   = ENC_VEC(PREFIX_16BIT, VEX_PP_66, 1, 0x6f),
+  [VSTOREU]  = ENC_VEC(0xf3, VEX_PP_F3, 1, 0x7f),
+  [VSTOREA]  = ENC_VEC(PREFIX_16BIT, VEX_PP_66, 1, 0x7f),
+  [VSTORENT] = ENC_VEC(PREFIX_16BIT, VEX_PP_66, 0, 0xe7),
+};
+
+static const char *enc_names[] =
+{
+  [REG2REG] = "register to register move",
+  [IMM2REG] = "immediate to register move",
+  [REG2MEM] = "register to mem move",
+  [MEM2REG] = "memory to register move",
+  [XADD]    = "xadd",
+  [XCHG]    = "xchg",
+  [MFENCE]  = "mfence",
+  [LFENCE]  = "lfence",
+  [SFENCE]  = "sfence",
+  [ADD2MEM] = "add reg to mem",
+  [SUB2MEM] = "sub reg from mem",
+  [AND2MEM] = "and reg into mem",
+  [OR2MEM]  = "or reg into mem",
+  [XOR2MEM] = "xor reg into mem",
+  [ADD2REG] = "add mem to reg",
+  [SUB2REG] = "sub mem from reg",
+  [AND2REG] = "and mem into reg",
+  [OR2REG]  = "or mem into reg",
+  [XOR2REG] = "xor mem into reg",
+  [INCMEM]  = "inc mem",
+  [DECMEM]  = "dec mem",
+  [CMPXCHG] = "cmpxchg",
+  [CMPXCHGB] = "cmpxchg8b/16b",
+  [VLOADU]   = "vector load",
+  [VLOADA]   = "aligned vector load",
+  [VSTOREU]  = "vector store",
+  [VSTOREA]  = "aligned vector store",
+  [VSTORENT] = "non-temporal vector store",
+};
+
+// operand size or vector width in bytes -> enc_table column, -1 if unsupported
+static const signed char enc_size_index[VSZ_64 + 1] =
+{
+  [0 ... VSZ_64] = -1,
+  [ISZ_1] = 0, [ISZ_2] = 1, [ISZ_4] = 2, [ISZ_8] = 3,
+  [VSZ_16] = 1, [VSZ_32] = 2, [VSZ_64] = 3,
+};
+
+// ModR/M mod field -> displacement bytes
+static const unsigned char enc_disp_len[4] = { 0, 1, 4, 0 };
+
+// byte count -> mask of that many low bytes
+static const unsigned long enc_len_mask[9] =
+{
+  0, 0xff, 0xffff, 0xffffff, 0xffffffff,
+  0xffffffffffUL, 0xffffffffffffUL, 0xffffffffffffffUL, ~0UL
+};
+
+/*
+ * Function: enc_lookup
+ *
+ * Description:
+ *    find the descriptor for an instruction type/operand size pair
+ *
+ * Inputs:
+ *    int   type                   :  instruction type (REG2REG..VSTORENT)
+ *    short size                   :  operand size in bytes, vector width for IS_VEC types
+ *
+ * Output:
+ *    returns descriptor, exits on an unsupported size
+ */
+static inline const enc_desc_t *enc_lookup(int type, short size)
+{
+  if ((unsigned short)size > VSZ_64 || enc_size_index[size] < 0 || (size > ISZ_8) != IS_VEC(type) ||
+      enc_table[type][enc_size_index[size]].head_len == 0)
+  {
+    fprintf(stderr,"ERROR: Incorrect size (%d) passed to %s\n", size, enc_names[type]);
+    exit(-1);
+  }
+
+  return(&enc_table[type][enc_size_index[size]]);
+}
+
+/*
+ * Function: encode_insn_sib
+ *
+ * Description:
+ *    encodes one instruction, memory operands are [rm + index * (1 << scale)
+ *    + disp].  The addressing special cases are handled here:
+ *
+ *    - rsp/r12 as a base, or any index, needs a SIB byte
+ *    - rbp/r13 as a base with mod 00 would mean rip-relative (no base
+ *      with a SIB), they get a zero disp8 instead
+ *    - rsp can't be an index, its SIB encoding means none (NO_INDEX)
+ *
+ * Inputs:
+ *    const enc_desc_t *d          :  instruction descriptor
+ *    int   reg                    :  ModR/M reg field register (FORM_MODRM), 0-15
+ *    int   rm                     :  ModR/M r/m register or base, or opcode register (FORM_OPREG), 0-15
+ *    int   index                  :  index register, NO_INDEX for none
+ *    int   scale                  :  log2 of the index scale, 0-3
+ *    unsigned char mod            :  DISP0/DISP8/DISP32/BASE_MODRM
+ *    int   disp                   :  displacement value, in bytes even when EVEX compresses disp8
+ *    long  imm                    :  immediate value
+ *    short lock                   :  include LOCK prefix
+ *    volatile char *tgt_addr      :  starting memory address of where to store instruction
+ *
+ * Output:
+ *    returns adjusted address after encoding instruction
+ *
+ * Note: stores up to ENC_STORE bytes, the tail is overwritten by whatever
+ *       is encoded next so callers need that much slack past the limit.
+ */
+static inline volatile char *encode_insn_sib(const enc_desc_t *d, int reg, int rm, int index, int scale, unsigned char mod, int disp, long imm, short lock, volatile char *tgt_addr)
+{
+  unsigned long head = d->head;
+  unsigned long modrm, tail;
+  int has_modrm = (d->form == FORM_MODRM || d->form == FORM_MODRM_EXT);
+  int is_mem = has_modrm && mod != BASE_MODRM;
+  int has_sib, disp_len, disp_shift, head_len, rex;
+
+  if (d->form == FORM_MODRM_EXT)
+  {
+    reg = d->ext;
+  }
+  else if (d->form == FORM_OPREG)
+  {
+    // register lives in the low bits of the last opcode byte
+    head += (unsigned long)(rm & RM_MASK) << (8 * (d->head_len - 1));
+    reg = 0;
+  }
+
+  if (is_mem && mod == DISP0_MODRM && (rm & RM_MASK) == REG_EBP)
+  {
+    mod = DISP8_MODRM;
+    disp = 0;
+  }
+
+  has_sib = is_mem && ((rm & RM_MASK) == REG_ESP || index != NO_INDEX);
+  disp_len = has_modrm ? enc_disp_len[(mod >> MODRM_SHIFT) & MOD_MASK] : 0;
+  disp_shift = (disp_len == 1) ? d->disp8_shift : 0;
+  head_len = d->head_len;
+
+  // register extensions: reg -> R, index -> X, base/rm -> B
+  rex = ((reg >> 1) & REX_R) | (has_sib ? (index >> 2) & REX_X : 0) | ((rm >> 3) & REX_B);
+
+  if (d->vex == ENC_LEGACY)
+  {
+    int pos = 8 * d->pfx_len;
+
+    // REX sits between the legacy prefixes and the opcode
+    rex |= d->rex_w ? REX_W : 0;
+    if (rex)
+    {
+      head = (head & ((1UL << pos) - 1)) | (unsigned long)(REX_PREFIX | rex) << pos | (head >> pos) << (pos + 8);
+      head_len++;
+    }
+  }
+  else if (d->vex == ENC_VEX2 && (rex & (REX_X | REX_B)))
+  {
+    // 2-byte VEX has no X/B, rewrite as C4 [RXB 0F] [W=0 vvvv L pp] opcode
+    head = VEX3_PREFIX | (unsigned long)((~rex & 0x7) << 5 | VEX_MAP_0F) << 8
+         | ((head >> 8) & 0x7f) << 16 | (head >> 16) << 24;
+    head_len++;
+  }
+  else
+  {
+    // VEX R, EVEX R/X/B are stored inverted in the byte after the escape
+    head ^= (unsigned long)(rex & (d->vex == ENC_EVEX ? 0x7 : REX_R)) << 13;
+  }
+
+  // prefixes + opcode, LOCK goes first
+  head = lock ? (head << 8) | PREFIX_LOCK : head;
+  head_len += (lock != 0);
+
+  // ModR/M and SIB, masked off for forms without them
+  modrm = (unsigned char)(mod + ((reg & REG_MASK) << REG_SHIFT) + (has_sib ? REG_ESP : rm & RM_MASK));
+  modrm |= (unsigned long)(unsigned char)(scale << MODRM_SHIFT | (index & REG_MASK) << REG_SHIFT | (rm & RM_MASK)) << 8;
+  modrm &= enc_len_mask[has_modrm + has_sib];
+  head |= modrm << (8 * head_len);
+  head_len += has_modrm + has_sib;
+
+  // displacement followed by immediate, the table keeps the pair within 8 bytes
+  tail = ((unsigned long)(unsigned int)(disp >> disp_shift) & enc_len_mask[disp_len])
+       | ((unsigned long)imm & enc_len_mask[d->imm_len]) << (8 * disp_len);
+
+  // whole instruction in two stores
+  *(volatile unsigned long *)tgt_addr = head;
+  *(volatile unsigned long *)(tgt_addr + head_len) = tail;
+
+  return(tgt_addr + head_len + disp_len + d->imm_len);
+}
+
+// register and [base + disp] forms, no index
+static inline volatile char *encode_insn(const enc_desc_t *d, int reg, int rm, unsigned char mod, int disp, long imm, short lock, volatile char *tgt_addr)
+{
+  return(encode_insn_sib(d, reg, rm, NO_INDEX, 0, mod, disp, imm, lock, tgt_addr));
+}
+
+static inline void enc_check_disp(unsigned char disp_type, const char *what)
+{
+  if (disp_type != DISP0_MODRM && disp_type != DISP8_MODRM && disp_type != DISP32_MODRM)
+  {
+    fprintf(stderr,"ERROR: Invalid displacement (%d) passed to %s\n", disp_type, what);
+    exit(-3);
+  }
+}
+
 /*
  * Function: build_mov_register_to_register
  *
@@ -123,36 +509,7 @@
  */
 static inline volatile char *build_mov_register_to_register(short mov_size, int src_reg, int dest_reg, volatile char *tgt_addr)
 {
-  switch(mov_size)  
-  {
-    case ISZ_1: 
-      (*(short *) tgt_addr) = ((BASE_MODRM) + (dest_reg << REG_SHIFT) + src_reg) << 8 | 0x8a;
-      tgt_addr += BYTE2_OFF;
-      break;
-
-    case ISZ_2:
-      *tgt_addr = PREFIX_16BIT;
-      tgt_addr += BYTE1_OFF;
-      // FALL THROUGH
-      
-    case ISZ_4:
-      (*(short *) tgt_addr) = ((BASE_MODRM) + (dest_reg << REG_SHIFT) + src_reg) << 8 | 0x8b;
-      tgt_addr += BYTE2_OFF;
-      break;
-      
-    case ISZ_8:
-      *tgt_addr = (REX_PREFIX | REX_W);
-      tgt_addr += BYTE1_OFF;
-      (*(short *) tgt_addr) = ((BASE_MODRM) + (dest_reg << REG_SHIFT) + src_reg) << 8 | 0x8b;
-      tgt_addr += BYTE2_OFF;
-      break;
-    
-    default:
-      fprintf(stderr,"ERROR: Incorrect size (%d) passed to register to register move\n", mov_size);
-      exit(-1);
-  }
-  
-  return(tgt_addr);
+  return(encode_insn(enc_lookup(REG2REG, mov_size), dest_reg, src_reg, BASE_MODRM, 0, 0, 0, tgt_addr));
 }
 
 /*
@@ -169,46 +526,7 @@ static inline volatile char *build_mov_register_to_register(short mov_size, int
  */
 static inline volatile char *build_imm_to_register(short mov_size, long imm, int dest_reg, volatile char *tgt_addr)
 {
-  switch(mov_size)  
-  {
-    case ISZ_1: 
-      (*(short *) tgt_addr) = (BASE_MODRM + dest_reg) << 8 | 0xc6;
-      tgt_addr += BYTE2_OFF;
-      *tgt_addr = (char)imm;
-      tgt_addr += BYTE1_OFF;
-      break;
-
-    case ISZ_2:
-      *tgt_addr = PREFIX_16BIT;
-      tgt_addr += BYTE1_OFF;
-      (*(short *) tgt_addr) = (BASE_MODRM + dest_reg) << 8 | 0xc7;
-      tgt_addr += BYTE2_OFF;
-      (*(short *) tgt_addr) = (short)imm;
-      tgt_addr += BYTE2_OFF;
-      break;
-      
-    case ISZ_4:
-      (*(short *) tgt_addr) = (BASE_MODRM + dest_reg) << 8 | 0xc7;
-      tgt_addr += BYTE2_OFF;
-      (*(int *) tgt_addr) = (int)imm;
-      tgt_addr += BYTE4_OFF;
-      break;
-      
-    case ISZ_8:
-      *tgt_addr = (REX_PREFIX | REX_W);
-      tgt_addr += BYTE1_OFF;
-      *tgt_addr = (0xb8 + dest_reg);
-      tgt_addr += BYTE1_OFF;
-      (*(long *) tgt_addr) = imm;
-      tgt_addr += BYTE8_OFF;
-      break;
-      
-    default:
-      fprintf(stderr,"ERROR: Incorrect size (%d) passed to immediate to register move\n", mov_size);
-      exit(-2);
-  }
-  
-  return(tgt_addr);
+  return(encode_insn(enc_lookup(IMM2REG, mov_size), 0, dest_reg, BASE_MODRM, 0, imm, 0, tgt_addr));
 }
 
 /*
@@ -227,112 +545,14 @@ static inline volatile char *build_imm_to_register(short mov_size, long imm, int
  */
 static inline volatile char *build_reg_to_memory(short mov_size, int src_reg, int dest_reg, unsigned char disp_type, int disp, volatile char *tgt_addr)
 {
-  switch(mov_size)  
-  {
-    case ISZ_1: 
-      (*(short *) tgt_addr) = (disp_type + (src_reg << REG_SHIFT) + dest_reg) << 8 | 0x88;
-      tgt_addr += BYTE2_OFF;
-      break;
-
-    case ISZ_2:
-      *tgt_addr = PREFIX_16BIT;
-      tgt_addr += BYTE1_OFF;
-      // FALL THROUGH
-      
-    case ISZ_4:
-      (*(short *) tgt_addr) = (disp_type + (src_reg << REG_SHIFT) + dest_reg) << 8 | 0x89;
-      tgt_addr += BYTE2_OFF;
-      break;
-    
-    case ISZ_8:
-      *tgt_addr = (REX_PREFIX | REX_W);
-      tgt_addr += BYTE1_OFF;
-      (*(short *) tgt_addr) = (disp_type + (src_reg << REG_SHIFT) + dest_reg) << 8 | 0x89;
-      tgt_addr += BYTE2_OFF;
-      break;
-    
-    default:
-      fprintf(stderr,"ERROR: Incorrect size (%d) passed to register to mem move\n", mov_size);
-      exit(-3);
-  }
-  
-  switch(disp_type)
-  {
-    case DISP0_MODRM:
-      // no displacement
-      break;
-      
-    case DISP8_MODRM:
-      *tgt_addr = (char)disp;
-      tgt_addr += BYTE1_OFF;
-      break;
-      
-    case DISP32_MODRM:
-      (*(int *) tgt_addr) = (int)disp;
-      tgt_addr += BYTE4_OFF;
-      break;
-      
-    default:
-      fprintf(stderr,"ERROR: Invalid displacement (%d) passed to register to memory move\n", disp_type);
-      exit(-3);
-  }
-  
-  return(tgt_addr);
+  enc_check_disp(disp_type, enc_names[REG2MEM]);
+  return(encode_insn(enc_lookup(REG2MEM, mov_size), src_reg, dest_reg, disp_type, disp, 0, 0, tgt_addr));
 }
 
 static inline volatile char *build_mov_memory_to_register(short mov_size, int src_reg, int dest_reg, unsigned char disp_type, int disp, volatile char *tgt_addr)
 {
-  switch(mov_size)  
-  {
-    case ISZ_1: 
-      (*(short *) tgt_addr) = (disp_type + (dest_reg << REG_SHIFT) + src_reg) << 8 | 0x8a;
-      tgt_addr += BYTE2_OFF;
-      break;
-
-    case ISZ_2:
-      (*tgt_addr) = PREFIX_16BIT;
-      tgt_addr += BYTE1_OFF;
-      // FALL THROUGH
-      
-    case ISZ_4:
-      (*(short *) tgt_addr) = (disp_type + (dest_reg << REG_SHIFT) + src_reg) << 8 | 0x8b;
-      tgt_addr += BYTE2_OFF;
-      break;
-      
-    case ISZ_8:
-      (*(char *) tgt_addr) = (REX_PREFIX | REX_W);
-      tgt_addr += BYTE1_OFF;
-      (*(short *) tgt_addr) = (disp_type + (dest_reg << REG_SHIFT) + src_reg) << 8 | 0x8b;
-      tgt_addr += BYTE2_OFF;
-      break;
-    
-    default:
-      fprintf(stderr,"ERROR: Incorrect size (%d) passed to memory to register move\n", mov_size);
-      exit(-1);
-  }
-  
-  switch(disp_type)
-  {
-    case DISP0_MODRM:
-      // no displacement
-      break;
-      
-    case DISP8_MODRM:
-      (*(char *) tgt_addr) = (char)disp;
-      tgt_addr += BYTE1_OFF;
-      break;
-      
-    case DISP32_MODRM:
-      (*(int *) tgt_addr) = (int)disp;
-      tgt_addr += BYTE4_OFF;
-      break;
-      
-    default:
-      fprintf(stderr,"ERROR: Invalid displacement (%d) passed to memory to register move\n", disp_type);
-      exit(-3);
-  }
-  
-  return(tgt_addr);
+  enc_check_disp(disp_type, enc_names[MEM2REG]);
+  return(encode_insn(enc_lookup(MEM2REG, mov_size), dest_reg, src_reg, disp_type, disp, 0, 0, tgt_addr));
 }
 
 /*
@@ -355,67 +575,8 @@ static inline volatile char *build_mov_memory_to_register(short mov_size, int sr
  */
 static inline volatile char *build_xadd(short size, int src_reg, int dest_reg, unsigned char disp_type, int disp, short lock, volatile char *tgt_addr)
 {
-  if (lock)
-  {
-    *tgt_addr = PREFIX_LOCK;
-    tgt_addr += BYTE1_OFF; 
-  }
-
-  switch(size)  
-  {
-    case ISZ_1: 
-      (*(short *) tgt_addr) = 0xc00f;
-      tgt_addr += BYTE2_OFF;
-      break;
-
-    case ISZ_2:
-      *tgt_addr = PREFIX_16BIT;
-      tgt_addr += BYTE1_OFF;
-      // FALL THROUGH
-      
-    case ISZ_4:
-      (*(short *) tgt_addr) = 0xc10f;
-      tgt_addr += BYTE2_OFF;
-      break;
-    
-    case ISZ_8:
-      *tgt_addr = (REX_PREFIX | REX_W);
-      tgt_addr += BYTE1_OFF;
-      (*(short *) tgt_addr) = 0xc10f;
-      tgt_addr += BYTE2_OFF;
-      break;
-    
-      default:
-        fprintf(stderr,"ERROR: Incorrect size (%d) passed to xadd\n", size);
-        exit(-4);
-    }
-
-    // same ModR/M byte for all
-    *tgt_addr = (disp_type + (src_reg << REG_SHIFT) + dest_reg);
-    tgt_addr += BYTE1_OFF;
-  
-    switch(disp_type)
-    {
-      case DISP0_MODRM:
-        // no displacement
-        break;
-      
-      case DISP8_MODRM:
-        *tgt_addr = (char)disp;
-        tgt_addr += BYTE1_OFF;
-        break;
-      
-      case DISP32_MODRM:
-        (*(int *) tgt_addr) = (int)disp;
-        tgt_addr += BYTE4_OFF;
-        break;
-      
-      default:
-        fprintf(stderr,"ERROR: Invalid displacement (%d) passed to xadd\n", disp_type);
-        exit(-3);
-    }
-    
-    return(tgt_addr);
+  enc_check_disp(disp_type, enc_names[XADD]);
+  return(encode_insn(enc_lookup(XADD, size), src_reg, dest_reg, disp_type, disp, 0, lock, tgt_addr));
 }
 
 /*
@@ -438,63 +599,119 @@ static inline volatile char *build_xadd(short size, int src_reg, int dest_reg, u
  */
 static inline volatile char *build_xchg(short size, int src_reg, int dest_reg, unsigned char disp_type, int disp, short lock, volatile char *tgt_addr)
 {
-  if (lock)
-  {
-    *tgt_addr = PREFIX_LOCK;
-    tgt_addr += BYTE1_OFF; 
-  }
+  enc_check_disp(disp_type, enc_names[XCHG]);
+  return(encode_insn(enc_lookup(XCHG, size), src_reg, dest_reg, disp_type, disp, 0, lock, tgt_addr));
+}
 
-  switch(size)  
-  {
-    case ISZ_1: 
-      (*(short *) tgt_addr) = (disp_type + (src_reg << REG_SHIFT) + dest_reg) << 8 | 0x86;
-      tgt_addr += BYTE2_OFF;
-      break;
-
-    case ISZ_2:
-      *tgt_addr = PREFIX_16BIT;
-      tgt_addr += BYTE1_OFF;
-      // FALL THROUGH
-      
-    case ISZ_4:
-      (*(short *) tgt_addr) = (disp_type + (src_reg << REG_SHIFT) + dest_reg) << 8 | 0x87;
-      tgt_addr += BYTE2_OFF;
-      break;
-    
-    case ISZ_8:
-      *tgt_addr = (REX_PREFIX | REX_W);
-      tgt_addr += BYTE1_OFF;
-      (*(short *) tgt_addr) = (disp_type + (src_reg << REG_SHIFT) + dest_reg) << 8 | 0x87;
-      tgt_addr += BYTE2_OFF;
-      break;
-    
-    default:
-      fprintf(stderr,"ERROR: Incorrect size (%d) passed to xchg\n", size);
-      exit(-5);
-  }
-  
-  switch(disp_type)
-  {
-    case DISP0_MODRM:
-      // no displacement
-      break;
-      
-    case DISP8_MODRM:
-      *tgt_addr = (char)disp;
-      tgt_addr += BYTE1_OFF;
-      break;
-      
-    case DISP32_MODRM:
-      (*(int *) tgt_addr) = (int)disp;
-      tgt_addr += BYTE4_OFF;
-      break;
-      
-    default:
-      fprintf(stderr,"ERROR: Invalid displacement (%d) passed to xchg\n", disp_type);
-      exit(-5);
-  }
-    
-  return(tgt_addr);
+/*
+ * Function: build_alu_reg_to_memory
+ *
+ * Description:
+ *    op [dest_reg + disp], src_reg for alu_type ADD2MEM..XOR2MEM, with
+ *    optional lock prefix
+ *
+ * Inputs: 
+ *    int   alu_type               :  ADD2MEM, SUB2MEM, AND2MEM, OR2MEM or XOR2MEM
+ *    short size                   :  operand size
+ *    int   src_reg                :  register source encoding 
+ *    int   dest_reg               :  base register of the memory operand
+ *    unsigned char disp_type      :  0/8/32-bit displacement type
+ *    int   disp                   :  displacement value
+ *    short lock                   :  include LOCK prefix
+ *    volatile char *tgt_addr      :  starting memory address of where to store instruction
+ *
+ * Output: 
+ *    returns adjusted address after encoding instruction
+ */
+static inline volatile char *build_alu_reg_to_memory(int alu_type, short size, int src_reg, int dest_reg, unsigned char disp_type, int disp, short lock, volatile char *tgt_addr)
+{
+  enc_check_disp(disp_type, enc_names[alu_type]);
+  return(encode_insn(enc_lookup(alu_type, size), src_reg, dest_reg, disp_type, disp, 0, lock, tgt_addr));
+}
+
+/*
+ * Function: build_alu_memory_to_register
+ *
+ * Description:
+ *    op dest_reg, [src_reg + disp] for alu_type ADD2REG..XOR2REG
+ */
+static inline volatile char *build_alu_memory_to_register(int alu_type, short size, int src_reg, int dest_reg, unsigned char disp_type, int disp, volatile char *tgt_addr)
+{
+  enc_check_disp(disp_type, enc_names[alu_type]);
+  return(encode_insn(enc_lookup(alu_type, size), dest_reg, src_reg, disp_type, disp, 0, 0, tgt_addr));
+}
+
+/*
+ * Function: build_inc_dec
+ *
+ * Description:
+ *    inc/dec [dest_reg + disp] (type INCMEM or DECMEM), optional lock prefix
+ */
+static inline volatile char *build_inc_dec(int type, short size, int dest_reg, unsigned char disp_type, int disp, short lock, volatile char *tgt_addr)
+{
+  enc_check_disp(disp_type, enc_names[type]);
+  return(encode_insn(enc_lookup(type, size), 0, dest_reg, disp_type, disp, 0, lock, tgt_addr));
+}
+
+/*
+ * Function: build_cmpxchg
+ *
+ * Description:
+ *    cmpxchg [dest_reg + disp], src_reg, compares with and loads the
+ *    accumulator (al/ax/eax/rax), optional lock prefix
+ */
+static inline volatile char *build_cmpxchg(short size, int src_reg, int dest_reg, unsigned char disp_type, int disp, short lock, volatile char *tgt_addr)
+{
+  enc_check_disp(disp_type, enc_names[CMPXCHG]);
+  return(encode_insn(enc_lookup(CMPXCHG, size), src_reg, dest_reg, disp_type, disp, 0, lock, tgt_addr));
+}
+
+/*
+ * Function: build_cmpxchg8b16b
+ *
+ * Description:
+ *    cmpxchg8b (size ISZ_4) or cmpxchg16b (size ISZ_8) [dest_reg + disp]:
+ *    compares rdx:rax with the memory pair, stores rcx:rbx on a match.
+ *    cmpxchg16b faults unless the address is 16-byte aligned.
+ */
+static inline volatile char *build_cmpxchg8b16b(short size, int dest_reg, unsigned char disp_type, int disp, short lock, volatile char *tgt_addr)
+{
+  enc_check_disp(disp_type, enc_names[CMPXCHGB]);
+  return(encode_insn(enc_lookup(CMPXCHGB, size), 0, dest_reg, disp_type, disp, 0, lock, tgt_addr));
+}
+
+/*
+ * Function: build_vec_load / build_vec_store
+ *
+ * Description:
+ *    vector load vreg <- [base_reg + disp] (type VLOADU or VLOADA) and
+ *    store [base_reg + disp] <- vreg (VSTOREU, VSTOREA or VSTORENT), width
+ *    VSZ_16/32/64 picks xmm/ymm/zmm.  The aligned and non-temporal forms
+ *    fault unless the address is width aligned.  An EVEX disp8 is scaled
+ *    by 64, so disp must be a multiple of 64 for DISP8_MODRM at VSZ_64.
+ *
+ * Inputs: 
+ *    int   type                   :  vector type
+ *    short width                  :  vector width in bytes
+ *    int   vreg                   :  xmm/ymm/zmm register number, 0-7
+ *    int   base_reg               :  base register of the memory operand
+ *    unsigned char disp_type      :  0/8/32-bit displacement type
+ *    int   disp                   :  displacement in bytes
+ *    volatile char *tgt_addr      :  starting memory address of where to store instruction
+ *
+ * Output: 
+ *    returns adjusted address after encoding instruction
+ */
+static inline volatile char *build_vec_load(int type, short width, int vreg, int base_reg, unsigned char disp_type, int disp, volatile char *tgt_addr)
+{
+  enc_check_disp(disp_type, enc_names[type]);
+  return(encode_insn(enc_lookup(type, width), vreg, base_reg, disp_type, disp, 0, 0, tgt_addr));
+}
+
+static inline volatile char *build_vec_store(int type, short width, int vreg, int base_reg, unsigned char disp_type, int disp, volatile char *tgt_addr)
+{
+  enc_check_disp(disp_type, enc_names[type]);
+  return(encode_insn(enc_lookup(type, width), vreg, base_reg, disp_type, disp, 0, 0, tgt_addr));
 }
 
 static inline volatile char *build_enter(short size, volatile char *tgt_addr)
@@ -524,7 +741,7 @@ static inline volatile char *build_push_reg(int reg_index, int x86_64f, volatile
   {
     *tgt_addr++ = (REX_PREFIX | REX_B);
   }
-  *tgt_addr++ = 0x50 + reg_index;
+  *tgt_addr++ = 0x50 + (reg_index & RM_MASK);
             
   return(tgt_addr);
 }
@@ -546,7 +763,7 @@ static inline volatile char *build_pop_reg(int reg_index, int x86_64f, volatile
   {
     *tgt_addr++ = (REX_PREFIX | REX_B);
   }
-  *tgt_addr++ = 0x58 + reg_index;
+  *tgt_addr++ = 0x58 + (reg_index & RM_MASK);
             
   return(tgt_addr);
 }
@@ -565,29 +782,210 @@ static inline volatile char *build_return(volatile char *tgt_addr)
   return(tgt_addr);
 }
 
-static inline volatile char *build_mfence(volatile char *tgt_addr)
+/*
+ * Control and frame helpers
+ *
+ * Used by the preamble/postamble (barriers, frame slots), not by the
+ * random instruction stream, so they are encoded directly.
+ */
+
+// condition codes for build_jcc8/build_jcc32
+#define CC_E           0x4
+#define CC_NE          0x5
+
+// group 1 ALU /digit for build_alu_imm8
+#define ALU_ADD        0x0
+#define ALU_XOR        0x6
+#define ALU_CMP        0x7
+
+/*
+ * Function: build_alu_imm8
+ *
+ * Description:
+ *    83 /digit ib group 1 ALU op on a 32/64-bit register (add=0, xor=6, cmp=7)
+ *
+ * Inputs: 
+ *    int   op_ext                 :  /digit selecting the ALU operation
+ *    short size                   :  ISZ_4 or ISZ_8
+ *    int   reg                    :  register operand, r8-r15 included
+ *    char  imm                    :  sign extended 8-bit immediate
+ *    volatile char *tgt_addr      :  starting memory address of where to store instruction
+ *
+ * Output: 
+ *    returns adjusted address after encoding instruction
+ */
+static inline volatile char *build_alu_imm8(int op_ext, short size, int reg, char imm, volatile char *tgt_addr)
+{
+  if (size == ISZ_8 || reg >= REG_R8)
+  {
+    *tgt_addr++ = REX_PREFIX | ((size == ISZ_8) ? REX_W : 0) | ((reg >> 3) & REX_B);
+  }
+  *tgt_addr++ = 0x83;
+  *tgt_addr++ = BASE_MODRM + (op_ext << REG_SHIFT) + (reg & REG_MASK);
+  *tgt_addr++ = imm;
+
+  return(tgt_addr);
+}
+
+/*
+ * Function: build_cmp_memory_to_register
+ *
+ * Description:
+ *    cmp r32, [base + disp8]
+ */
+static inline volatile char *build_cmp_memory_to_register(int base_reg, int reg, char disp, volatile char *tgt_addr)
+{
+  *tgt_addr++ = 0x3b;
+  *tgt_addr++ = DISP8_MODRM + (reg << REG_SHIFT) + base_reg;
+  *tgt_addr++ = disp;
+
+  return(tgt_addr);
+}
+
+/*
+ * Function: build_imm_to_memory
+ *
+ * Description:
+ *    mov dword [base + disp8], imm32
+ */
+static inline volatile char *build_imm_to_memory(int imm, int base_reg, char disp, volatile char *tgt_addr)
+{
+  *tgt_addr++ = 0xc7;
+  *tgt_addr++ = DISP8_MODRM + base_reg;
+  *tgt_addr++ = disp;
+  (*(int *) tgt_addr) = imm;
+  tgt_addr += BYTE4_OFF;
+
+  return(tgt_addr);
+}
+
+/*
+ * Function: build_rsp_store / build_rsp_load
+ *
+ * Description:
+ *    mov [rsp + disp8], r64 and mov r64, [rsp + disp8] for frame slots.
+ *    rsp as a base always needs a SIB byte (0x24: no index, base rsp).
+ */
+static inline volatile char *build_rsp_store(int reg, char disp, volatile char *tgt_addr)
+{
+  *tgt_addr++ = (REX_PREFIX | REX_W);
+  *tgt_addr++ = 0x89;
+  *tgt_addr++ = DISP8_MODRM + (reg << REG_SHIFT) + REG_ESP;
+  *tgt_addr++ = 0x24;
+  *tgt_addr++ = disp;
+
+  return(tgt_addr);
+}
+
+static inline volatile char *build_rsp_load(int reg, char disp, volatile char *tgt_addr)
+{
+  *tgt_addr++ = (REX_PREFIX | REX_W);
+  *tgt_addr++ = 0x8b;
+  *tgt_addr++ = DISP8_MODRM + (reg << REG_SHIFT) + REG_ESP;
+  *tgt_addr++ = 0x24;
+  *tgt_addr++ = disp;
+
+  return(tgt_addr);
+}
+
+/*
+ * Function: build_jcc8 / build_jmp8
+ *
+ * Description:
+ *    short conditional/unconditional jumps, rel8 is relative to the end of
+ *    the jump.  Forward jumps can be emitted with 0 and fixed up with
+ *    patch_rel8() once the target is known.
+ */
+static inline volatile char *build_jcc8(int cc, char rel, volatile char *tgt_addr)
+{
+  *tgt_addr++ = 0x70 + cc;
+  *tgt_addr++ = rel;
+
+  return(tgt_addr);
+}
+
+static inline volatile char *build_jmp8(char rel, volatile char *tgt_addr)
+{
+  *tgt_addr++ = 0xeb;
+  *tgt_addr++ = rel;
+
+  return(tgt_addr);
+}
+
+// jump_end is the address just past a short jump, target where it should land
+static inline void patch_rel8(volatile char *jump_end, volatile char *target)
+{
+  *(jump_end - 1) = (char)(target - jump_end);
+}
+
+// near jcc, 0f 80+cc rel32, for jumps back over a whole random body
+static inline volatile char *build_jcc32(int cc, int rel, volatile char *tgt_addr)
 {
   *tgt_addr++ = 0x0f;
-  *tgt_addr++ = 0xae;
-  *tgt_addr++ = 0xf0;
-    
+  *tgt_addr++ = 0x80 + cc;
+  (*(int *) tgt_addr) = rel;
+  tgt_addr += BYTE4_OFF;
+
   return(tgt_addr);
 }
 
-static inline volatile char *build_lfence(volatile char *tgt_addr)
+static inline void patch_rel32(volatile char *jump_end, volatile char *target)
 {
-  *tgt_addr++ = 0x0f; 
-  *tgt_addr++ = 0xae;
-  *tgt_addr++ = 0xe8;
-    
+  *(volatile int *)(jump_end - BYTE4_OFF) = (int)(target - jump_end);
+}
+
+static inline volatile char *build_pause(volatile char *tgt_addr)
+{
+  *tgt_addr++ = 0xf3;
+  *tgt_addr++ = 0x90;
+
   return(tgt_addr);
 }
 
-static inline volatile char *build_sfence(volatile char *tgt_addr)
+// vzeroall (VEX.256.0F 77) zeroes every vector register, zmm upper bits included
+static inline volatile char *build_vzeroall(volatile char *tgt_addr)
 {
+  *tgt_addr++ = VEX2_PREFIX;
+  *tgt_addr++ = VEX2_BYTE(1, VEX_PP_NONE);
+  *tgt_addr++ = 0x77;
+
+  return(tgt_addr);
+}
+
+// vzeroupper (VEX.128.0F 77), avoids SSE/AVX transition penalties in the caller
+static inline volatile char *build_vzeroupper(volatile char *tgt_addr)
+{
+  *tgt_addr++ = VEX2_PREFIX;
+  *tgt_addr++ = VEX2_BYTE(0, VEX_PP_NONE);
+  *tgt_addr++ = 0x77;
+
+  return(tgt_addr);
+}
+
+// pxor xmm, xmm (66 0F EF /r), zeroes the low 128 bits without AVX
+static inline volatile char *build_pxor_self(int vreg, volatile char *tgt_addr)
+{
+  *tgt_addr++ = PREFIX_16BIT;
   *tgt_addr++ = 0x0f;
-  *tgt_addr++ = 0xae;
-  *tgt_addr++ = 0xf8;
-    
+  *tgt_addr++ = 0xef;
+  *tgt_addr++ = BASE_MODRM + (vreg << REG_SHIFT) + vreg;
+
   return(tgt_addr);
 }
+
+static inline volatile char *build_mfence(volatile char *tgt_addr)
+{
+  return(encode_insn(&enc_table[MFENCE][0], 0, 0, 0, 0, 0, 0, tgt_addr));
+}
+
+static inline volatile char *build_lfence(volatile char *tgt_addr)
+{
+  return(encode_insn(&enc_table[LFENCE][0], 0, 0, 0, 0, 0, 0, tgt_addr));
+}
+
+static inline volatile char *build_sfence(volatile char *tgt_addr)
+{
+  return(encode_insn(&enc_table[SFENCE][0], 0, 0, 0, 0, 0, 0, tgt_addr));
+}
+
+#endif
@@ -0,0 +1,211 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ *
+ * Instruction IR
+ *
+ * build_instructions() works in two phases: generation picks every random
+ * choice and records it here, then a separate pass encodes the whole array.
+ * The IR is the record of what a test case contains, so logging, replay,
+ * checking and minimization can work on it without decoding machine code.
+ *
+ * Operands follow the build_* argument order: src/dest are the source and
+ * destination registers, and for memory forms the base register sits in
+ * whichever of the two is the memory operand (dest for stores and the
+ * read-modify-write forms, src for loads and ALU reg, [mem]), with an
+ * optional index register and scale (NO_INDEX when there is none).
+ * Registers are 0-15, r8-r15 included.  Register forms carry BASE_MODRM
+ * as disp_type.  inc/dec carry their implicit 1 in
+ * imm so the golden model can treat them as add/sub.  Vector loads and
+ * stores keep their width in size and an xmm/ymm/zmm number in place of
+ * the register operand; disp is always in bytes.
+ */
+
+#ifndef INSN_IR_H
+#define INSN_IR_H
+
+#include "ia32_encode.h"
+
+#define NUM_GPRS     16
+
+typedef struct
+{
+  unsigned long init_regs[NUM_GPRS];  // register values the preamble loads
+  int count;                  // instructions in use
+  int loops;                  // times the body runs in a counted loop, 0 for once with no loop
+  int cap;                    // instructions allocated
+  unsigned char *type;        // REG2REG..VSTORENT
+  unsigned char *size;        // operand size or vector width in bytes
+  unsigned char *src;
+  unsigned char *dest;
+  unsigned char *disp_type;   // DISP0/DISP8/DISP32/BASE_MODRM
+  unsigned char *index;       // SIB index register, NO_INDEX for none
+  unsigned char *scale;       // log2 of the index scale
+  unsigned char *lock;
+  int  *disp;
+  long *imm;
+  unsigned int *code_off;     // filled by ir_encode(): offset into the code buffer
+} insn_ir_t;
+
+// which IR operand goes in the ModR/M reg field, the other one is r/m
+static const unsigned char ir_reg_is_dest[] =
+{
+  [REG2REG] = 1, [IMM2REG] = 0, [REG2MEM] = 0, [MEM2REG] = 1,
+  [XADD]    = 0, [XCHG]    = 0, [MFENCE]  = 0, [LFENCE]  = 0, [SFENCE] = 0,
+  [ADD2MEM] = 0, [SUB2MEM] = 0, [AND2MEM] = 0, [OR2MEM]  = 0, [XOR2MEM] = 0,
+  [ADD2REG] = 1, [SUB2REG] = 1, [AND2REG] = 1, [OR2REG]  = 1, [XOR2REG] = 1,
+  [INCMEM]  = 0, [DECMEM]  = 0, [CMPXCHG] = 0, [CMPXCHGB] = 0,
+  [VLOADU]  = 1, [VLOADA]  = 1, [VSTOREU] = 0, [VSTOREA] = 0, [VSTORENT] = 0,
+};
+
+// bytes of one IR block for cap instructions, the layout ir_carve() gives it
+#define IR_BYTES(cap) ((size_t)(cap) * (8 * sizeof(unsigned char) + 2 * sizeof(int) + sizeof(long)))
+
+/*
+ * Function: ir_carve
+ *
+ * Description:
+ *    point the arrays of ir into one IR_BYTES(cap) block, which is also
+ *    how a test case's IR is laid out in a corpus file
+ */
+static inline void ir_carve(insn_ir_t *ir, char *block, int cap)
+{
+  // widest arrays first so everything stays naturally aligned
+  ir->imm       = (long *)block;
+  ir->disp      = (int *)(ir->imm + cap);
+  ir->code_off  = (unsigned int *)(ir->disp + cap);
+  ir->type      = (unsigned char *)(ir->code_off + cap);
+  ir->size      = ir->type + cap;
+  ir->src       = ir->size + cap;
+  ir->dest      = ir->src + cap;
+  ir->disp_type = ir->dest + cap;
+  ir->index     = ir->disp_type + cap;
+  ir->scale     = ir->index + cap;
+  ir->lock      = ir->scale + cap;
+  ir->cap       = cap;
+  ir->count     = 0;
+  ir->loops     = 0;
+}
+
+/*
+ * Function: ir_alloc
+ *
+ * Description:
+ *    allocate room for cap instructions, all arrays carved from one block
+ *
+ * Output:
+ *    0 on success, -1 if the allocation failed
+ */
+static inline int ir_alloc(insn_ir_t *ir, int cap)
+{
+  char *block = malloc(IR_BYTES(cap) + sizeof(long));   // never zero sized
+
+  if (block == NULL)
+  {
+    return(-1);
+  }
+
+  ir_carve(ir, block, cap);
+  return(0);
+}
+
+static inline void ir_free(insn_ir_t *ir)
+{
+  free(ir->imm);
+  ir->imm = NULL;
+  ir->cap = ir->count = 0;
+}
+
+// copy instruction i of src into slot j of dst
+static inline void ir_copy_insn(insn_ir_t *dst, int j, const insn_ir_t *src, int i)
+{
+  dst->type[j]      = src->type[i];
+  dst->size[j]      = src->size[i];
+  dst->src[j]       = src->src[i];
+  dst->dest[j]      = src->dest[i];
+  dst->disp_type[j] = src->disp_type[i];
+  dst->index[j]     = src->index[i];
+  dst->scale[j]     = src->scale[i];
+  dst->lock[j]      = src->lock[i];
+  dst->disp[j]      = src->disp[i];
+  dst->imm[j]       = src->imm[i];
+  dst->code_off[j]  = src->code_off[i];
+}
+
+// the last instruction starting at or before code offset off, -1 if off is before the first
+static inline int ir_find_insn(const insn_ir_t *ir, long off)
+{
+  int lo = 0, hi = ir->count - 1, found = -1;
+
+  while (lo <= hi)
+  {
+    int mid = (lo + hi) / 2;
+
+    if ((long)ir->code_off[mid] <= off)
+    {
+      found = mid;
+      lo = mid + 1;
+    }
+    else
+    {
+      hi = mid - 1;
+    }
+  }
+
+  return(found);
+}
+
+/*
+ * Function: ir_encode_one
+ *
+ * Inputs:
+ *    insn_ir_t *ir                :  instruction array
+ *    int   i                      :  index of the instruction to encode
+ *    volatile char *tgt_addr      :  starting memory address of where to store instruction
+ *
+ * Output:
+ *    returns adjusted address after encoding instruction
+ */
+static inline volatile char *ir_encode_one(const insn_ir_t *ir, int i, volatile char *tgt_addr)
+{
+  int type = ir->type[i];
+  int reg_is_dest = ir_reg_is_dest[type];
+  int reg = reg_is_dest ? ir->dest[i] : ir->src[i];
+  int rm  = reg_is_dest ? ir->src[i]  : ir->dest[i];
+
+  return(encode_insn_sib(enc_lookup(type, ir->size[i]), reg, rm, ir->index[i], ir->scale[i],
+                         ir->disp_type[i], ir->disp[i], ir->imm[i], ir->lock[i], tgt_addr));
+}
+
+/*
+ * Function: ir_encode
+ *
+ * Description:
+ *    bulk encode the IR, stopping early if the code buffer limit is reached
+ *
+ * Inputs:
+ *    insn_ir_t *ir                :  instruction array, code_off is filled in
+ *    volatile char *base          :  start of the code buffer, code_off is relative to it
+ *    volatile char *tgt_addr      :  starting memory address of where to store instructions
+ *    long  limit                  :  address no instruction may start at or beyond
+ *    int  *num_encoded            :  returns number of instructions encoded
+ *
+ * Output:
+ *    returns adjusted address after the last encoded instruction
+ */
+static inline volatile char *ir_encode(insn_ir_t *ir, volatile char *base, volatile char *tgt_addr, long limit, int *num_encoded)
+{
+  int i;
+
+  for (i = 0; i < ir->count && (long)tgt_addr < limit; i++)
+  {
+    ir->code_off[i] = tgt_addr - base;
+    tgt_addr = ir_encode_one(ir, i, tgt_addr);
+  }
+
+  *num_encoded = i;
+  return(tgt_addr);
+}
+
+#endif
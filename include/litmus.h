@@ -0,0 +1,134 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ *
+ * Memory ordering litmus tests
+ *
+ * -L runs one of the classic shapes instead of random bodies, each thread
+ * its part of it on two shared locations x and y:
+ *
+ *    sb     store buffering    T0: x=1 r0=y        T1: y=1 r0=x
+ *    mp     message passing    T0: x=1 y=1         T1: r0=y r1=x
+ *    lb     load buffering     T0: r0=x y=1        T1: r0=y x=1
+ *    iriw   independent reads  T0: x=1  T1: y=1    T2: r0=x r1=y  T3: r0=y r1=x
+ *
+ * optionally with +mfence between each thread's accesses or +lock, which
+ * makes every store an xchg.  x86-TSO allows exactly one relaxed outcome
+ * of these, SB's 0/0 without fences; the others are forbidden and seeing
+ * one is a bug.
+ *
+ * Each thread's code runs up to LIT_RING iterations per call without
+ * coming back to C, every iteration after a spin barrier, on locations of
+ * its own: iteration k uses line k of the x and y arrays, so nothing has
+ * to be reset between iterations.  What each thread loaded goes to its
+ * own out array, one line per iteration.  Between calls thread 0 folds
+ * the ring's outcomes into a histogram, zeroes x and y and sets the next
+ * call's iteration count (only the last call of a run is short); the
+ * other threads are held at the next call's start barrier meanwhile and
+ * read the count after it.
+ *
+ *    0                      x[LIT_RING], a line each
+ *    LIT_ARRAY              y[LIT_RING]
+ *    LIT_ARRAY * (2 + t)    thread t's out[LIT_RING], loaded values as bytes
+ *    LIT_HIST_OFF           LIT_OUTCOMES counts
+ *    LIT_COUNT_OFF          iterations of the current call, an int
+ */
+
+#ifndef LITMUS_H
+#define LITMUS_H
+
+#include <stdio.h>
+
+#define LIT_RING         1024               // iterations per call into the generated code
+#define LIT_MAX_THREADS  4
+#define LIT_MAX_OPS      2                  // accesses per thread
+#define LIT_LOCS         2                  // x, y
+#define LIT_STRIDE       64                 // one line per iteration in every array
+#define LIT_ARRAY        (LIT_RING * LIT_STRIDE)
+#define LIT_HIST_OFF     ((LIT_LOCS + LIT_MAX_THREADS) * LIT_ARRAY)
+#define LIT_OUTCOMES     256                // an outcome is a bit per load, thread by thread
+#define LIT_COUNT_OFF    (LIT_HIST_OFF + LIT_OUTCOMES * sizeof(unsigned long))
+
+// lit_op_t.op
+#define LIT_NONE         0
+#define LIT_STORE        1                  // loc = 1
+#define LIT_LOAD         2                  // next register = loc
+
+typedef struct
+{
+  char op;
+  char loc;                   // 0 for x, 1 for y
+} lit_op_t;
+
+typedef struct
+{
+  const char *name;
+  int nthreads;
+  lit_op_t ops[LIT_MAX_THREADS][LIT_MAX_OPS];
+  unsigned int relaxed;       // outcome that needs a reordering
+  int tso_allows;             // x86-TSO allows it without fences or locks
+} litmus_test_t;
+
+typedef struct
+{
+  const litmus_test_t *test;
+  int mfence;                 // +mfence
+  int lock;                   // +lock
+} litmus_t;
+
+/*
+ * Function: litmus_parse
+ *
+ * Inputs:
+ *    litmus_t *l                  :  returns the test and its variant
+ *    const char *spec             :  sb, mp, lb or iriw, then +mfence or +lock
+ *
+ * Output:
+ *    0 on success, -1 for an unknown test or variant
+ */
+int litmus_parse(litmus_t *l, const char *spec);
+
+// data buffer bytes a litmus run needs, shared by every thread
+long litmus_data_bytes(void);
+
+/*
+ * Function: litmus_build
+ *
+ * Description:
+ *    encodes thread t's part of the test as a loop of up to LIT_RING
+ *    iterations, as many as LIT_COUNT_OFF says, inside the usual frame,
+ *    called as test(data, ctx)
+ *
+ * Output:
+ *    address after the code, NULL if it doesn't fit in code_bytes
+ */
+volatile char *litmus_build(const litmus_t *l, int t, volatile char *code, long code_bytes);
+
+/*
+ * Function: litmus_tally
+ *
+ * Description:
+ *    thread 0, between calls: adds the ring's outcomes to the histogram
+ *    and zeroes x and y for the next call
+ */
+void litmus_tally(const litmus_t *l, volatile char *data);
+
+// thread 0, before a call: the iterations it runs, 1..LIT_RING
+static inline void litmus_set_count(volatile char *data, int count)
+{
+  *(volatile int *)(data + LIT_COUNT_OFF) = count;
+}
+
+/*
+ * Function: litmus_report
+ *
+ * Description:
+ *    prints the histogram, the relaxed outcome marked
+ *
+ * Output:
+ *    1 if an outcome x86-TSO forbids was seen, else 0
+ */
+int litmus_report(FILE *out, const litmus_t *l, volatile char *data);
+
+#endif
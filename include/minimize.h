@@ -0,0 +1,103 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ *
+ * Test case minimization
+ *
+ * Shrinks a failing test case's IR to a small reproducer.  Every
+ * candidate reduction is run in its own forked child pinned to one of the
+ * minimizer's CPUs: the child copies the data buffer as it was before the
+ * failing test case, encodes the candidate, runs it and checks it against
+ * the golden model.  A candidate reproduces when it fails the same way as
+ * the original (golden mismatch, the same fatal signal, or a hang caught
+ * by an alarm).  Up to one candidate per CPU runs at a time and the first
+ * one in candidate order that reproduces wins, so the result depends only
+ * on the test case, not on the number of CPUs or who finished first.
+ *
+ * Candidates run single threaded, the failing thread's test case alone on
+ * its own data snapshot.  Only failures that thread reproduces by itself
+ * can be reduced: one that needs the other threads (a cross-thread race
+ * on -D shared data, a -U signature mismatch) passes the rerun, and
+ * minimize() reports MIN_PASS without touching the test case.
+ *
+ * The passes, repeated until none of them makes progress:
+ *
+ *    ddmin     delta debugging over the instruction list: keep a chunk,
+ *              or drop one, at finer and finer granularity
+ *    lock      drop LOCK prefixes one instruction at a time
+ *    size      halve operand sizes and vector widths where the encoding
+ *              and displacement allow
+ */
+
+#ifndef MINIMIZE_H
+#define MINIMIZE_H
+
+#include "insn_ir.h"
+
+#define MIN_MAX_WORKERS  64
+#define MIN_TIMEOUT      2          // seconds before a candidate counts as hung
+
+// how a run ended, a fatal signal is MIN_CRASH | signal << 8
+#define MIN_PASS         0
+#define MIN_MISMATCH     1
+#define MIN_HANG         2
+#define MIN_CRASH        3
+#define MIN_ERROR        4          // the child couldn't set itself up
+
+typedef struct
+{
+  int workers;                      // candidates run at once
+  int cpus[MIN_MAX_WORKERS];        // CPU for each of them
+  const unsigned char *snapshot;    // data buffer before the failing test case
+  long data_bytes;
+  long code_bytes;
+  int golden;                       // check results, without it only crashes and hangs reproduce
+  int fail;                         // the original failure, MIN_*
+  long runs;                        // candidates executed
+  volatile char *code;              // private scratch buffers, each child gets its own copy
+  volatile char *data;
+  insn_ir_t cand[MIN_MAX_WORKERS];
+} minimizer_t;
+
+/*
+ * Function: minimize_init
+ *
+ * Inputs:
+ *    minimizer_t *m               :  minimizer state
+ *    const int *cpus              :  CPU for each worker
+ *    int workers                  :  candidates to run at once, up to MIN_MAX_WORKERS
+ *    const unsigned char *snapshot :  data buffer before the failing test case, data_bytes long
+ *    long data_bytes              :  size of the data buffer
+ *    long code_bytes              :  size of the code buffer a test case needs
+ *    int golden                   :  check against the golden model
+ *    int cap                      :  most instructions a candidate can hold
+ *
+ * Output:
+ *    0 on success, -1 if the buffers couldn't be allocated
+ */
+int minimize_init(minimizer_t *m, const int *cpus, int workers, const unsigned char *snapshot,
+                  long data_bytes, long code_bytes, int golden, int cap);
+
+/*
+ * Function: minimize
+ *
+ * Description:
+ *    reruns ir to learn how it fails, then reduces it in place
+ *
+ * Inputs:
+ *    minimizer_t *m               :  from minimize_init()
+ *    insn_ir_t *ir                :  failing test case, replaced by the reproducer
+ *
+ * Output:
+ *    the failure being reproduced; MIN_PASS if the test case passes on
+ *    its own, MIN_ERROR if it couldn't be run, and nothing was done
+ */
+int minimize(minimizer_t *m, insn_ir_t *ir);
+
+// "golden mismatch", "hang", "crash, signal 11" ...
+const char *minimize_describe(int fail, char *buf, int len);
+
+void minimize_free(minimizer_t *m);
+
+#endif
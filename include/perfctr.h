@@ -0,0 +1,143 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ *
+ * Hardware performance counters
+ *
+ * Each worker opens one perf_event_open group on itself (user mode only,
+ * so perf_event_paranoid 2 is enough) and reads it, together with the
+ * TSC, right before and right after the generated code runs.  The deltas
+ * accumulate in the thread's shared result slot for the parent to
+ * aggregate.  Counters the CPU or kernel doesn't offer are left out of
+ * the group; if the group leader can't be opened at all (VMs, containers,
+ * no PMU) only the TSC is collected.
+ *
+ * Machine clears and locked loads use Intel raw encodings (Skylake and
+ * later, most earlier cores agree) and are only requested on Intel CPUs.
+ */
+
+#ifndef PERFCTR_H
+#define PERFCTR_H
+
+#include <stdio.h>
+#include <unistd.h>
+#include <x86intrin.h>
+
+#define PC_CYCLES      0    // core cycles
+#define PC_INSTS       1    // instructions retired
+#define PC_MCLEARS     2    // machine clears, memory ordering
+#define PC_L1D_MISS    3    // L1D read misses
+#define PC_LLC_MISS    4    // last level cache misses
+#define PC_LOCK_LOADS  5    // locked loads retired
+#define PC_NUM         6
+
+typedef struct
+{
+  unsigned long tsc;              // TSC ticks inside the generated code
+  unsigned long count[PC_NUM];
+  unsigned long valid;            // 1 << PC_* for counters that counted
+} perfctr_counts_t;
+
+typedef struct
+{
+  int leader;                     // group fd, -1 for TSC only
+  int nopen;                      // counters in the group
+  int fd[PC_NUM];                 // in group order
+  signed char slot[PC_NUM];       // position in the group read, -1 if not open
+  unsigned long tsc0;
+  unsigned long start[PC_NUM + 1];
+} perfctr_t;
+
+extern const char *perfctr_names[PC_NUM];
+
+/*
+ * Function: perfctr_open
+ *
+ * Inputs:
+ *    perfctr_t *pc                :  counter state for the calling process
+ *    int use_pmu                  :  0 for TSC only
+ *
+ * Output:
+ *    number of hardware counters opened, 0 means TSC only
+ */
+int perfctr_open(perfctr_t *pc, int use_pmu);
+
+void perfctr_close(perfctr_t *pc);
+
+// PERF_FORMAT_GROUP read: nr followed by one value per counter
+static inline int perfctr_read(perfctr_t *pc, unsigned long *vals)
+{
+  long want = (pc->nopen + 1) * sizeof(unsigned long);
+
+  return(read(pc->leader, vals, want) == want);
+}
+
+/*
+ * Function: perfctr_start / perfctr_stop
+ *
+ * Description:
+ *    bracket the code being measured, stop adds the deltas into acc.  A
+ *    group the kernel couldn't keep on the PMU for the whole window reads
+ *    short and only the TSC is counted for that window.
+ */
+static inline void perfctr_start(perfctr_t *pc)
+{
+  if (pc->leader >= 0 && !perfctr_read(pc, pc->start))
+  {
+    pc->start[0] = 0;
+  }
+
+  _mm_lfence();
+  pc->tsc0 = __rdtsc();
+  _mm_lfence();
+}
+
+static inline void perfctr_stop(perfctr_t *pc, perfctr_counts_t *acc)
+{
+  unsigned int aux;
+  unsigned long now[PC_NUM + 1];
+  unsigned long tsc1 = __rdtscp(&aux);
+
+  _mm_lfence();
+  acc->tsc += tsc1 - pc->tsc0;
+
+  if (pc->leader >= 0 && pc->start[0] && perfctr_read(pc, now))
+  {
+    for (int k = 0; k < PC_NUM; k++)
+    {
+      if (pc->slot[k] >= 0)
+      {
+        acc->count[k] += now[1 + pc->slot[k]] - pc->start[1 + pc->slot[k]];
+        acc->valid |= 1UL << k;
+      }
+    }
+  }
+}
+
+/*
+ * Function: perfctr_report
+ *
+ * Description:
+ *    one line of counts, derived IPC and TSC ticks per test case
+ *
+ * Inputs:
+ *    FILE *out                    :  where to print
+ *    const char *label            :  line prefix, e.g. "T3" or "total"
+ *    const perfctr_counts_t *c    :  accumulated counts
+ *    long tests                   :  test cases the counts cover
+ */
+void perfctr_report(FILE *out, const char *label, const perfctr_counts_t *c, long tests);
+
+// sum b into a, a counter stays valid only if every thread counted it
+static inline void perfctr_add(perfctr_counts_t *a, const perfctr_counts_t *b, int first)
+{
+  a->tsc += b->tsc;
+  for (int k = 0; k < PC_NUM; k++)
+  {
+    a->count[k] += b->count[k];
+  }
+  a->valid = first ? b->valid : (a->valid & b->valid);
+}
+
+#endif
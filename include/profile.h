@@ -0,0 +1,92 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ *
+ * Instruction mix profiles
+ *
+ * A profile weights the generator's random choices: instruction type,
+ * operand size and displacement form, plus the probability of a LOCK
+ * prefix where one is legal.  It is given on the command line as
+ * comma separated key=value items, or as @file with the same items one
+ * or more per line (whitespace or commas between them, # comments):
+ *
+ *    reg2reg imm2reg reg2mem mem2reg xadd xchg mfence lfence sfence
+ *    add2mem sub2mem and2mem or2mem xor2mem add2reg sub2reg and2reg
+ *    or2reg xor2reg inc dec cmpxchg cmpxchgb vloadu vloada vstoreu
+ *    vstorea vstorent      type weights (cmpxchgb: cmpxchg8b/16b)
+ *    size1 size2 size4 size8
+ *                          operand size weights
+ *    vec16 vec32 vec64     vector width weights (xmm, ymm, zmm)
+ *    disp0 disp8 disp32    displacement form weights
+ *    lock                  percent of lockable instructions locked
+ *    split                 percent of unaligned vector accesses that
+ *                          cross a cache line
+ *    index                 percent of memory operands with a SIB index
+ *
+ * Weights are relative.  A group left out entirely stays uniform; once
+ * any key of a group is given, the group's missing keys weigh 0.  So
+ * "xadd=1,xchg=1,lock=100" is all locked RMW and no fences, and
+ * "mem2reg=4,reg2mem=1,size8=1" is load heavy with 8-byte operands only.
+ *
+ * Each group is compiled into a Walker/Vose alias table, so a draw costs
+ * one random number and one compare whatever the weights are.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "ia32_encode.h"
+#include "rng.h"
+
+#define ALIAS_MAX      NUM_TYPES        // the largest group
+
+typedef struct
+{
+  int n;
+  unsigned long thresh[ALIAS_MAX];      // keep column k if u32 < thresh, 1 << 32 always keeps
+  unsigned char alias[ALIAS_MAX];
+} alias_t;
+
+typedef struct
+{
+  alias_t type;                         // REG2REG.. instruction types
+  alias_t size;                         // log2 of the operand size
+  alias_t vec;                          // log2 of the vector width / 16
+  alias_t disp;                         // 0/1/2: DISP0/DISP8/DISP32
+  int lock_pct;
+  int split_pct;
+  int index_pct;
+} profile_t;
+
+/*
+ * Function: profile_parse
+ *
+ * Inputs:
+ *    profile_t *prof              :  compiled profile
+ *    const char *spec             :  key=value list, or @file
+ *
+ * Output:
+ *    0 on success, -1 on a bad key, weight or file (reported on stderr)
+ */
+int profile_parse(profile_t *prof, const char *spec);
+
+// print the effective percentages
+void profile_print(FILE *out, const profile_t *prof);
+
+/*
+ * Function: alias_draw
+ *
+ * Description:
+ *    one draw from an alias table: the high half of a random number picks
+ *    a column, the low half decides between it and its alias
+ */
+static inline int alias_draw(const alias_t *t, rng_t *rng)
+{
+  uint64_t r = rng_next(rng);
+  int k = (int)(((r >> 32) * (uint64_t)t->n) >> 32);
+
+  return(((r & 0xffffffff) < t->thresh[k]) ? k : t->alias[k]);
+}
+
+#endif
@@ -0,0 +1,90 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ *
+ * Per-thread random number streams
+ *
+ * xoshiro256** generator, seeded through splitmix64 from the tuple
+ * (seed, thread id, iteration).  Every thread/iteration pair gets its own
+ * independent stream, and a test case can be regenerated from just those
+ * three numbers without replaying anything that came before it.
+ */
+
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+typedef struct
+{
+  uint64_t s[4];
+} rng_t;
+
+static inline uint64_t rng_rotl(uint64_t x, int k)
+{
+  return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t rng_splitmix64(uint64_t *x)
+{
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+/*
+ * Function: rng_seed
+ *
+ * Inputs:
+ *    rng_t *rng                   :  generator state to initialize
+ *    uint64_t seed                :  user seed (-s)
+ *    uint64_t thread_id           :  logical thread id
+ *    uint64_t iteration           :  test case number within the thread
+ */
+static inline void rng_seed(rng_t *rng, uint64_t seed, uint64_t thread_id, uint64_t iteration)
+{
+  uint64_t x = seed;
+
+  // fold the key through splitmix so neighbouring keys land far apart
+  x = rng_splitmix64(&x) ^ thread_id;
+  x = rng_splitmix64(&x) ^ iteration;
+
+  for (int i = 0; i < 4; i++)
+  {
+    rng->s[i] = rng_splitmix64(&x);
+  }
+}
+
+static inline uint64_t rng_next(rng_t *rng)
+{
+  uint64_t *s = rng->s;
+  uint64_t result = rng_rotl(s[1] * 5, 7) * 9;
+  uint64_t t = s[1] << 17;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rng_rotl(s[3], 45);
+
+  return result;
+}
+
+/*
+ * Function: rng_range
+ *
+ * Description:
+ *    uniform integer in [min_n, max_n], multiply-shift instead of modulo
+ */
+static inline int rng_range(rng_t *rng, int min_n, int max_n)
+{
+  uint64_t span = (uint64_t)(max_n - min_n) + 1;
+
+  return min_n + (int)(((rng_next(rng) >> 32) * span) >> 32);
+}
+
+#endif
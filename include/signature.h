@@ -0,0 +1,59 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ *
+ * Test case signatures
+ *
+ * A 64-bit hash of a thread's data buffer and the registers its postamble
+ * captured.  Two runs of the same test case that end in the same state
+ * have the same signature, so comparing signatures replaces diffing the
+ * buffers.  The hash is CRC32C over four interleaved lanes, using the
+ * SSE4.2 crc32 instruction when the CPU has it and an equivalent table
+ * driven version otherwise; both give the same result.
+ *
+ * The base registers (rdi, r12 and r13, BASE_REGS in golden.h) are hashed
+ * as offsets from the data buffer and rsp is left out, so where the
+ * buffer and stack live doesn't matter, but a body that copies rsp or a
+ * base into other registers or memory makes the state address dependent.
+ * -U generates bodies that never read any of them, so every thread of a
+ * -U run must end with the same signature; otherwise signatures only
+ * compare between runs with ASLR off (setarch -R).
+ */
+
+#ifndef SIGNATURE_H
+#define SIGNATURE_H
+
+/*
+ * Function: sig_init
+ *
+ * Description:
+ *    builds the crc table and picks the SSE4.2 or table driven version;
+ *    call once from main() before any thread or child can hash
+ */
+void sig_init(void);
+
+/*
+ * Function: sig_hash
+ *
+ * Inputs:
+ *    const volatile void *buf     :  bytes to hash
+ *    long  len                    :  length in bytes
+ *    unsigned long seed           :  chaining value, 0 to start
+ *
+ * Output:
+ *    64-bit signature of seed and buf
+ */
+unsigned long sig_hash(const volatile void *buf, long len, unsigned long seed);
+
+// fold one test case signature into a thread's running signature
+static inline unsigned long sig_chain(unsigned long chain, unsigned long sig)
+{
+  unsigned long z = chain ^ sig;
+
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9UL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebUL;
+  return(z ^ (z >> 31));
+}
+
+#endif
@@ -0,0 +1,56 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ *
+ * CPU placement
+ *
+ * Reads the package/core layout of every CPU this process may run on
+ * (sched_getaffinity, so cgroup cpusets and taskset are honoured) from
+ * /sys/devices/system/cpu and maps logical thread ids onto CPUs according
+ * to a placement policy:
+ *
+ *    linear    thread i on the i-th allowed CPU (the old CPU_SET(i))
+ *    compact   fill SMT siblings, then cores, then packages
+ *    smt       thread pairs on the two SMT siblings of one core
+ *    core      one thread per core, packages filled one at a time
+ *    socket    one thread per core, round robin across packages
+ *    spread    evenly spaced over the whole machine
+ *
+ * or an explicit CPU list such as "0,2,8-11", which may only name allowed
+ * CPUs too.
+ */
+
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+/*
+ * Function: topo_place
+ *
+ * Inputs:
+ *    const char *policy           :  placement policy name, NULL for linear
+ *    const char *cpulist          :  explicit CPU list, overrides policy
+ *    int nthreads                 :  number of logical threads
+ *    int *cpus                    :  returns the CPU for each thread
+ *
+ * Output:
+ *    0 on success, -1 on a bad policy or CPU list, or a list naming a
+ *    CPU outside our affinity mask
+ */
+int topo_place(const char *policy, const char *cpulist, int nthreads, int *cpus);
+
+/*
+ * Function: bind_to_cpu
+ *
+ * Description:
+ *    pin the calling process (or thread) to one CPU
+ *
+ * Output:
+ *    0 on success, -1 on failure
+ */
+int bind_to_cpu(int cpu);
+
+// CPUs this process may run on, 1 if that can't be read
+int topo_ncpus(void);
+
+#endif
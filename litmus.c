@@ -0,0 +1,204 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ * Memory ordering litmus tests, see include/litmus.h
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "litmus.h"
+#include "generate.h"
+
+#define W(loc)   { LIT_STORE, loc }
+#define R(loc)   { LIT_LOAD, loc }
+#define X        0
+#define Y        1
+
+static const litmus_test_t tests[] =
+{
+  { "sb",   2, { { W(X), R(Y) }, { W(Y), R(X) } },                            0x0, 1 },
+  { "mp",   2, { { W(X), W(Y) }, { R(Y), R(X) } },                            0x1, 0 },
+  { "lb",   2, { { R(X), W(Y) }, { R(Y), W(X) } },                            0x3, 0 },
+  { "iriw", 4, { { W(X) }, { W(Y) }, { R(X), R(Y) }, { R(Y), R(X) } },        0x5, 0 },
+};
+
+#define NUM_TESTS  (int)(sizeof(tests) / sizeof(tests[0]))
+
+// loaded values, in load order; rbx walks the arrays, ebp counts down, r11 holds the stored 1
+static const unsigned char load_regs[LIT_MAX_OPS] = { REG_R8, REG_R9 };
+
+int litmus_parse(litmus_t *l, const char *spec)
+{
+  const char *plus = strchr(spec, '+');
+  int len = plus ? (int)(plus - spec) : (int)strlen(spec);
+
+  memset(l, 0, sizeof(*l));
+  for (int k = 0; k < NUM_TESTS; k++)
+  {
+    if ((int)strlen(tests[k].name) == len && strncmp(spec, tests[k].name, len) == 0)
+    {
+      l->test = &tests[k];
+    }
+  }
+
+  if (l->test == NULL)
+  {
+    return(-1);
+  }
+
+  if (plus)
+  {
+    l->mfence = (strcmp(plus + 1, "mfence") == 0);
+    l->lock = (strcmp(plus + 1, "lock") == 0);
+    if (!l->mfence && !l->lock)
+    {
+      return(-1);
+    }
+  }
+
+  return(0);
+}
+
+long litmus_data_bytes(void)
+{
+  return(LIT_COUNT_OFF + sizeof(int));
+}
+
+volatile char *litmus_build(const litmus_t *l, int t, volatile char *code, long code_bytes)
+{
+  const lit_op_t *ops = l->test->ops[t];
+  volatile char *p, *loop;
+  int loads = 0;
+
+  p = gen_preamble(code);
+  p = build_mov_register_to_register(ISZ_8, REG_EDI, REG_EBX, p);
+  p = build_mov_memory_to_register(ISZ_4, REG_EBX, REG_EBP, DISP32_MODRM, LIT_COUNT_OFF, p);
+  p = build_imm_to_register(ISZ_4, 1, REG_R11, p);
+
+  // every iteration starts together, on fresh lines of x and y
+  loop = p;
+  p = gen_barrier(p);
+
+  for (int j = 0; j < LIT_MAX_OPS && ops[j].op != LIT_NONE; j++)
+  {
+    int disp = ops[j].loc * LIT_ARRAY;
+
+    if (j > 0 && l->mfence)
+    {
+      p = build_mfence(p);
+    }
+
+    if (ops[j].op == LIT_LOAD)
+    {
+      p = build_mov_memory_to_register(ISZ_4, REG_EBX, load_regs[loads++], DISP32_MODRM, disp, p);
+    }
+    else if (l->lock)
+    {
+      // xchg is locked without the prefix, and hands back the 0 it replaced
+      p = build_xchg(ISZ_4, REG_R11, REG_EBX, DISP32_MODRM, disp, 0, p);
+      p = build_imm_to_register(ISZ_4, 1, REG_R11, p);
+    }
+    else
+    {
+      p = build_reg_to_memory(ISZ_4, REG_R11, REG_EBX, DISP32_MODRM, disp, p);
+    }
+  }
+
+  // out of the racing part: record what was seen
+  for (int n = 0; n < loads; n++)
+  {
+    p = build_reg_to_memory(ISZ_1, load_regs[n], REG_EBX, DISP32_MODRM, (LIT_LOCS + t) * LIT_ARRAY + n, p);
+  }
+
+  p = build_alu_imm8(ALU_ADD, ISZ_8, REG_EBX, LIT_STRIDE, p);
+  p = build_alu_imm8(ALU_ADD, ISZ_4, REG_EBP, -1, p);
+  p = build_jcc8(CC_NE, 0, p);
+  if (p - loop > 128)
+  {
+    fprintf(stderr, "litmus %s: loop body too long for a short jump\n", l->test->name);
+    return(NULL);
+  }
+  patch_rel8(p, loop);
+
+  p = gen_postamble(p);
+
+  return((p - code > code_bytes) ? NULL : p);
+}
+
+void litmus_tally(const litmus_t *l, volatile char *data)
+{
+  const litmus_test_t *lt = l->test;
+  unsigned long *hist = (unsigned long *)(data + LIT_HIST_OFF);
+  int count = *(volatile int *)(data + LIT_COUNT_OFF);
+
+  for (int k = 0; k < count; k++)
+  {
+    unsigned int key = 0;
+    int bit = 0;
+
+    for (int t = 0; t < lt->nthreads; t++)
+    {
+      volatile char *out = data + (LIT_LOCS + t) * LIT_ARRAY + k * LIT_STRIDE;
+
+      for (int j = 0, n = 0; j < LIT_MAX_OPS; j++)
+      {
+        if (lt->ops[t][j].op == LIT_LOAD)
+        {
+          key |= (out[n++] & 1) << bit++;
+        }
+      }
+    }
+
+    hist[key]++;
+  }
+
+  // the loads' out bytes are all rewritten next time, x and y have to start at 0
+  memset((void *)data, 0, LIT_LOCS * LIT_ARRAY);
+}
+
+// "T0:r0=0 T1:r0=1" for an outcome key
+static void outcome_name(const litmus_test_t *lt, unsigned int key, char *buf, int len)
+{
+  int bit = 0, used = 0;
+
+  buf[0] = '\0';
+  for (int t = 0; t < lt->nthreads; t++)
+  {
+    for (int j = 0, n = 0; j < LIT_MAX_OPS; j++)
+    {
+      if (lt->ops[t][j].op == LIT_LOAD && used < len)
+      {
+        used += snprintf(buf + used, len - used, "%sT%d:r%d=%d", used ? " " : "", t, n++, (key >> bit++) & 1);
+      }
+    }
+  }
+}
+
+int litmus_report(FILE *out, const litmus_t *l, volatile char *data)
+{
+  const litmus_test_t *lt = l->test;
+  unsigned long *hist = (unsigned long *)(data + LIT_HIST_OFF);
+  int forbidden = !lt->tso_allows || l->mfence || l->lock;
+  unsigned long total = 0;
+  char name[96];
+
+  for (int k = 0; k < LIT_OUTCOMES; k++)
+  {
+    total += hist[k];
+  }
+
+  fprintf(out, "litmus %s%s: %lu iterations\n", lt->name, l->mfence ? "+mfence" : l->lock ? "+lock" : "", total);
+  for (int k = 0; k < LIT_OUTCOMES; k++)
+  {
+    if (hist[k] || k == (int)lt->relaxed)
+    {
+      outcome_name(lt, k, name, sizeof(name));
+      fprintf(out, "  %-40s %12lu  %8.4f%%%s\n", name, hist[k], total ? 100.0 * hist[k] / total : 0.0,
+              (k != (int)lt->relaxed) ? "" : forbidden ? "  <-- relaxed, forbidden by x86-TSO" : "  <-- relaxed, allowed by x86-TSO");
+    }
+  }
+
+  return(forbidden && hist[lt->relaxed] != 0);
+}
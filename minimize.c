@@ -0,0 +1,391 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ * Test case minimization, see include/minimize.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "minimize.h"
+#include "generate.h"
+#include "golden.h"
+#include "topology.h"
+
+typedef int (*min_test_t)(volatile char *data, void *ctx);
+
+// applies one reduction to instruction i of a candidate, 0 if it doesn't apply
+typedef int (*min_edit_t)(insn_ir_t *ir, int i);
+
+int minimize_init(minimizer_t *m, const int *cpus, int workers, const unsigned char *snapshot,
+                  long data_bytes, long code_bytes, int golden, int cap)
+{
+  memset(m, 0, sizeof(*m));
+
+  m->workers = (workers < 1) ? 1 : (workers > MIN_MAX_WORKERS) ? MIN_MAX_WORKERS : workers;
+  memcpy(m->cpus, cpus, m->workers * sizeof(int));
+  m->snapshot = snapshot;
+  m->data_bytes = data_bytes;
+  m->code_bytes = code_bytes;
+  m->golden = golden;
+
+  // private mappings: every child writes its own copy-on-write pages, then makes its code read/execute
+  m->code = mmap(NULL, code_bytes, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+  m->data = mmap(NULL, data_bytes, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+  if (m->code == MAP_FAILED || m->data == MAP_FAILED)
+  {
+    m->code = (m->code == MAP_FAILED) ? NULL : m->code;
+    m->data = (m->data == MAP_FAILED) ? NULL : m->data;
+    minimize_free(m);
+    return(-1);
+  }
+
+  for (int k = 0; k < m->workers; k++)
+  {
+    if (ir_alloc(&m->cand[k], cap) == -1)
+    {
+      minimize_free(m);
+      return(-1);
+    }
+  }
+
+  return(0);
+}
+
+void minimize_free(minimizer_t *m)
+{
+  for (int k = 0; k < MIN_MAX_WORKERS; k++)
+  {
+    if (m->cand[k].imm)
+    {
+      ir_free(&m->cand[k]);
+    }
+  }
+
+  if (m->code)
+  {
+    munmap((void *)m->code, m->code_bytes);
+  }
+  if (m->data)
+  {
+    munmap((void *)m->data, m->data_bytes);
+  }
+  m->code = m->data = NULL;
+}
+
+const char *minimize_describe(int fail, char *buf, int len)
+{
+  switch (fail & 0xff)
+  {
+    case MIN_PASS:     snprintf(buf, len, "pass"); break;
+    case MIN_MISMATCH: snprintf(buf, len, "golden mismatch"); break;
+    case MIN_HANG:     snprintf(buf, len, "hang (over %d s)", MIN_TIMEOUT); break;
+    case MIN_CRASH:    snprintf(buf, len, "crash, signal %d (%s)", fail >> 8, strsignal(fail >> 8)); break;
+    default:           snprintf(buf, len, "worker setup failed"); break;
+  }
+
+  return(buf);
+}
+
+/*
+ * Function: run_child
+ *
+ * Description:
+ *    child side of one candidate run, never returns.  The exit status is
+ *    the golden check result, anything fatal shows up as the signal.
+ */
+static void run_child(minimizer_t *m, insn_ir_t *ir, int cpu)
+{
+  barrier_t barrier = { 0 };
+  thread_ctx_t ctx = { 0 };
+  golden_t golden = { 0 };
+  int checked;
+
+  // candidates fail on purpose, the report of the original is enough
+  if (freopen("/dev/null", "w", stderr) == NULL || bind_to_cpu(cpu) == -1)
+  {
+    _exit(MIN_ERROR);
+  }
+
+  alarm(MIN_TIMEOUT);
+
+  memcpy((void *)m->data, m->snapshot, m->data_bytes);
+  encode_test(m->code, m->code_bytes, ir);
+  if (mprotect((void *)m->code, m->code_bytes, PROT_READ | PROT_EXEC) == -1)
+  {
+    _exit(MIN_ERROR);
+  }
+
+  ctx.barrier = &barrier;
+  ctx.nthreads = 1;
+
+  checked = m->golden ? golden_prepare(&golden, ir, m->data, m->data_bytes) : GOLDEN_UNCHECKED;
+  if (checked == -1)
+  {
+    _exit(MIN_ERROR);
+  }
+
+  ((min_test_t)m->code)(m->data, &ctx);
+
+  _exit((checked == 0) ? golden_check(&golden, ctx.regs, m->data, 0) : MIN_PASS);
+}
+
+// how a candidate's child ended, MIN_*
+static int run_class(int status)
+{
+  if (WIFSIGNALED(status))
+  {
+    return((WTERMSIG(status) == SIGALRM) ? MIN_HANG : (MIN_CRASH | WTERMSIG(status) << 8));
+  }
+
+  return((WIFEXITED(status) && WEXITSTATUS(status) <= MIN_MISMATCH) ? WEXITSTATUS(status) : MIN_ERROR);
+}
+
+/*
+ * Function: run_batch
+ *
+ * Description:
+ *    runs cand[0..n) at the same time, one per worker CPU
+ *
+ * Inputs:
+ *    minimizer_t *m               :  minimizer state
+ *    int n                        :  candidates filled in, at most m->workers
+ *    int *classes                 :  returns how each one ended, or NULL
+ *
+ * Output:
+ *    the first candidate that fails like the original, -1 if none does
+ */
+static int run_batch(minimizer_t *m, int n, int *classes)
+{
+  pid_t pids[MIN_MAX_WORKERS];
+  int first = -1;
+
+  for (int k = 0; k < n; k++)
+  {
+    if ((pids[k] = fork()) == 0)
+    {
+      run_child(m, &m->cand[k], m->cpus[k]);
+    }
+    else if (pids[k] == -1)
+    {
+      perror("minimize: fork");
+    }
+  }
+
+  for (int k = 0; k < n; k++)
+  {
+    int status, cls = MIN_ERROR;
+
+    if (pids[k] > 0 && waitpid(pids[k], &status, 0) == pids[k])
+    {
+      cls = run_class(status);
+      m->runs++;
+    }
+
+    if (classes)
+    {
+      classes[k] = cls;
+    }
+    if (first < 0 && cls == m->fail)
+    {
+      first = k;
+    }
+  }
+
+  return(first);
+}
+
+// dst = the instructions of src inside [lo, hi) if keep, outside it otherwise
+static void cand_range(insn_ir_t *dst, const insn_ir_t *src, int lo, int hi, int keep)
+{
+  int j = 0;
+
+  memcpy(dst->init_regs, src->init_regs, sizeof(dst->init_regs));
+  dst->loops = src->loops;
+  for (int i = 0; i < src->count; i++)
+  {
+    if ((i >= lo && i < hi) == keep)
+    {
+      ir_copy_insn(dst, j++, src, i);
+    }
+  }
+  dst->count = j;
+}
+
+static void cand_copy(insn_ir_t *dst, const insn_ir_t *src)
+{
+  cand_range(dst, src, 0, src->count, 1);
+}
+
+/*
+ * Function: pass_ddmin
+ *
+ * Description:
+ *    Zeller's ddmin over the instruction list: split it into n chunks,
+ *    try each chunk alone, then the list without each chunk.  A chunk that
+ *    reproduces restarts at n = 2, a complement at n - 1, and nothing
+ *    doubles the granularity until the chunks are single instructions.
+ *    Candidates go out a wave of m->workers at a time.
+ *
+ * Output:
+ *    1 if the test case got shorter
+ */
+static int pass_ddmin(minimizer_t *m, insn_ir_t *ir)
+{
+  int n = 2, progress = 0;
+
+  while (ir->count >= 2)
+  {
+    int chunk = (ir->count + n - 1) / n;
+    int nc = (ir->count + chunk - 1) / chunk;
+    int total = (nc == 2) ? 2 : 2 * nc;       // with two chunks the complements are the chunks
+    int found = -1, base;
+
+    for (base = 0; base < total; base += m->workers)
+    {
+      int w = (total - base < m->workers) ? total - base : m->workers;
+
+      for (int k = 0; k < w; k++)
+      {
+        int c = (base + k) % nc;
+
+        cand_range(&m->cand[k], ir, c * chunk, (c + 1) * chunk, base + k < nc);
+      }
+
+      if ((found = run_batch(m, w, NULL)) >= 0)
+      {
+        break;
+      }
+    }
+
+    if (found < 0)
+    {
+      if (chunk == 1)
+      {
+        break;
+      }
+      n = (2 * n < ir->count) ? 2 * n : ir->count;
+      continue;
+    }
+
+    cand_copy(ir, &m->cand[found]);
+    found += base;
+    n = (found < nc) ? 2 : (n - 1 > 2) ? n - 1 : 2;
+    progress = 1;
+  }
+
+  return(progress);
+}
+
+/*
+ * Function: pass_edit
+ *
+ * Description:
+ *    tries one edit per instruction, a wave of instructions at a time.
+ *    The first edit in a wave that reproduces is kept and the sweep
+ *    resumes at that instruction, since some edits apply again.
+ *
+ * Output:
+ *    1 if any edit was kept
+ */
+static int pass_edit(minimizer_t *m, insn_ir_t *ir, min_edit_t edit)
+{
+  int progress = 0, i = 0;
+
+  while (i < ir->count)
+  {
+    int at[MIN_MAX_WORKERS], w = 0, found;
+
+    for (; i < ir->count && w < m->workers; i++)
+    {
+      cand_copy(&m->cand[w], ir);
+      if (edit(&m->cand[w], i))
+      {
+        at[w++] = i;
+      }
+    }
+
+    if (w == 0)
+    {
+      break;
+    }
+
+    if ((found = run_batch(m, w, NULL)) >= 0)
+    {
+      cand_copy(ir, &m->cand[found]);
+      i = at[found];
+      progress = 1;
+    }
+  }
+
+  return(progress);
+}
+
+static int edit_lock(insn_ir_t *ir, int i)
+{
+  if (!ir->lock[i])
+  {
+    return(0);
+  }
+
+  ir->lock[i] = 0;
+  return(1);
+}
+
+// half the operand size or vector width, if that has an encoding the displacement still fits
+static int edit_size(insn_ir_t *ir, int i)
+{
+  int type = ir->type[i];
+  int half = ir->size[i] / 2;
+  const enc_desc_t *d;
+
+  if (type == MFENCE || type == LFENCE || type == SFENCE || half < (IS_VEC(type) ? VSZ_16 : ISZ_1) ||
+      enc_size_index[half] < 0 || enc_table[type][enc_size_index[half]].head_len == 0)
+  {
+    return(0);
+  }
+
+  // zmm disp8 counts 64 byte units, a narrower encoding may not reach
+  d = &enc_table[type][enc_size_index[half]];
+  if (ir->disp_type[i] == DISP8_MODRM &&
+      ((ir->disp[i] & ((1 << d->disp8_shift) - 1)) || (ir->disp[i] >> d->disp8_shift) < -128 ||
+       (ir->disp[i] >> d->disp8_shift) > 127))
+  {
+    return(0);
+  }
+
+  ir->size[i] = half;
+  return(1);
+}
+
+int minimize(minimizer_t *m, insn_ir_t *ir)
+{
+  int progress, cls;
+
+  // learn how the original fails, in a child like every candidate
+  cand_copy(&m->cand[0], ir);
+  m->fail = -1;
+  run_batch(m, 1, &cls);
+  m->fail = cls;
+
+  if (m->fail == MIN_PASS || m->fail == MIN_ERROR)
+  {
+    return(m->fail);
+  }
+
+  do
+  {
+    progress = pass_ddmin(m, ir);
+    progress |= pass_edit(m, ir, edit_lock);
+    progress |= pass_edit(m, ir, edit_size);
+  } while (progress);
+
+  return(m->fail);
+}
@@ -0,0 +1,140 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ * Hardware performance counters, see include/perfctr.h
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "perfctr.h"
+
+// Intel raw event encodings, umask << 8 | event
+#define RAW_MACHINE_CLEARS_MO   0x02c3    // MACHINE_CLEARS.MEMORY_ORDERING
+#define RAW_LOCK_LOADS          0x21d0    // MEM_INST_RETIRED.LOCK_LOADS
+
+const char *perfctr_names[PC_NUM] =
+{
+  [PC_CYCLES]     = "cycles",
+  [PC_INSTS]      = "insts",
+  [PC_MCLEARS]    = "mo clears",
+  [PC_L1D_MISS]   = "l1d miss",
+  [PC_LLC_MISS]   = "llc miss",
+  [PC_LOCK_LOADS] = "lock loads",
+};
+
+typedef struct
+{
+  unsigned int type;
+  unsigned long config;
+  int intel_only;
+} perfctr_event_t;
+
+static const perfctr_event_t perfctr_events[PC_NUM] =
+{
+  [PC_CYCLES]     = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, 0 },
+  [PC_INSTS]      = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, 0 },
+  [PC_MCLEARS]    = { PERF_TYPE_RAW, RAW_MACHINE_CLEARS_MO, 1 },
+  [PC_L1D_MISS]   = { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                                          PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                                          PERF_COUNT_HW_CACHE_RESULT_MISS << 16, 0 },
+  [PC_LLC_MISS]   = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, 0 },
+  [PC_LOCK_LOADS] = { PERF_TYPE_RAW, RAW_LOCK_LOADS, 1 },
+};
+
+static int perf_open(const perfctr_event_t *ev, int group_fd)
+{
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = ev->type;
+  attr.config = ev->config;
+  attr.read_format = PERF_FORMAT_GROUP;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  // the whole group on the PMU or nothing, no multiplexed estimates
+  attr.pinned = (group_fd == -1);
+
+  return(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+int perfctr_open(perfctr_t *pc, int use_pmu)
+{
+  int intel = __builtin_cpu_is("intel");
+
+  memset(pc, 0, sizeof(*pc));
+  pc->leader = -1;
+  memset(pc->slot, -1, sizeof(pc->slot));
+
+  if (!use_pmu)
+  {
+    return(0);
+  }
+
+  for (int k = 0; k < PC_NUM; k++)
+  {
+    int fd;
+
+    if (perfctr_events[k].intel_only && !intel)
+    {
+      continue;
+    }
+
+    if ((fd = perf_open(&perfctr_events[k], pc->leader)) == -1)
+    {
+      // no cycles counter, nothing else is worth trying
+      if (k == PC_CYCLES)
+      {
+        perror("perf_event_open, TSC only");
+        return(0);
+      }
+      continue;
+    }
+
+    if (pc->leader == -1)
+    {
+      pc->leader = fd;
+    }
+    pc->fd[pc->nopen] = fd;
+    pc->slot[k] = pc->nopen++;
+  }
+
+  return(pc->nopen);
+}
+
+void perfctr_close(perfctr_t *pc)
+{
+  // members first, the leader owns the group
+  while (pc->nopen > 0)
+  {
+    close(pc->fd[--pc->nopen]);
+  }
+  pc->leader = -1;
+}
+
+void perfctr_report(FILE *out, const char *label, const perfctr_counts_t *c, long tests)
+{
+  fprintf(out, "%s: %.0f tsc/test", label, tests ? (double)c->tsc / tests : 0.0);
+
+  for (int k = 0; k < PC_NUM; k++)
+  {
+    if (c->valid & (1UL << k))
+    {
+      fprintf(out, ", %lu %s", c->count[k], perfctr_names[k]);
+    }
+  }
+
+  if ((c->valid & (1UL << PC_CYCLES)) && (c->valid & (1UL << PC_INSTS)) && c->count[PC_CYCLES])
+  {
+    fprintf(out, ", IPC %.2f", (double)c->count[PC_INSTS] / c->count[PC_CYCLES]);
+  }
+
+  fprintf(out, "\n");
+}
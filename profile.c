@@ -0,0 +1,320 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ * Instruction mix profiles, see include/profile.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile.h"
+
+#define GRP_TYPE    0
+#define GRP_SIZE    1
+#define GRP_DISP    2
+#define GRP_VEC     3
+#define NUM_GRPS    4
+
+typedef struct
+{
+  const char *name;
+  int group;
+  int index;
+} prof_key_t;
+
+static const prof_key_t prof_keys[] =
+{
+  { "reg2reg", GRP_TYPE, REG2REG }, { "imm2reg", GRP_TYPE, IMM2REG },
+  { "reg2mem", GRP_TYPE, REG2MEM }, { "mem2reg", GRP_TYPE, MEM2REG },
+  { "xadd",    GRP_TYPE, XADD },    { "xchg",    GRP_TYPE, XCHG },
+  { "mfence",  GRP_TYPE, MFENCE },  { "lfence",  GRP_TYPE, LFENCE },
+  { "sfence",  GRP_TYPE, SFENCE },
+  { "add2mem", GRP_TYPE, ADD2MEM }, { "sub2mem", GRP_TYPE, SUB2MEM },
+  { "and2mem", GRP_TYPE, AND2MEM }, { "or2mem",  GRP_TYPE, OR2MEM },
+  { "xor2mem", GRP_TYPE, XOR2MEM }, { "add2reg", GRP_TYPE, ADD2REG },
+  { "sub2reg", GRP_TYPE, SUB2REG }, { "and2reg", GRP_TYPE, AND2REG },
+  { "or2reg",  GRP_TYPE, OR2REG },  { "xor2reg", GRP_TYPE, XOR2REG },
+  { "inc",     GRP_TYPE, INCMEM },  { "dec",     GRP_TYPE, DECMEM },
+  { "cmpxchg", GRP_TYPE, CMPXCHG }, { "cmpxchgb", GRP_TYPE, CMPXCHGB },
+  { "vloadu",  GRP_TYPE, VLOADU },  { "vloada",  GRP_TYPE, VLOADA },
+  { "vstoreu", GRP_TYPE, VSTOREU }, { "vstorea", GRP_TYPE, VSTOREA },
+  { "vstorent", GRP_TYPE, VSTORENT },
+  { "size1",   GRP_SIZE, 0 },       { "size2",   GRP_SIZE, 1 },
+  { "size4",   GRP_SIZE, 2 },       { "size8",   GRP_SIZE, 3 },
+  { "disp0",   GRP_DISP, 0 },       { "disp8",   GRP_DISP, 1 },
+  { "disp32",  GRP_DISP, 2 },
+  { "vec16",   GRP_VEC, 0 },        { "vec32",   GRP_VEC, 1 },
+  { "vec64",   GRP_VEC, 2 },
+};
+
+#define NUM_KEYS    (int)(sizeof(prof_keys) / sizeof(prof_keys[0]))
+
+static const int grp_len[NUM_GRPS] = { NUM_TYPES, 4, 3, 3 };
+static const char *grp_names[NUM_GRPS] = { "type", "size", "disp", "vec" };
+
+typedef struct
+{
+  double w[NUM_GRPS][ALIAS_MAX];
+  int given[NUM_GRPS];
+  int lock_pct;
+  int split_pct;
+  int index_pct;
+} prof_spec_t;
+
+/*
+ * Function: alias_build
+ *
+ * Description:
+ *    Vose's alias method: columns scaled to an average of 1, each short
+ *    column is topped up from a tall one that becomes its alias
+ *
+ * Output:
+ *    0 on success, -1 if every weight is 0
+ */
+static int alias_build(alias_t *t, const double *w, int n)
+{
+  double p[ALIAS_MAX], sum = 0;
+  int small[ALIAS_MAX], large[ALIAS_MAX];
+  int ns = 0, nl = 0;
+
+  for (int k = 0; k < n; k++)
+  {
+    sum += w[k];
+  }
+  if (sum <= 0)
+  {
+    return(-1);
+  }
+
+  t->n = n;
+  for (int k = 0; k < n; k++)
+  {
+    p[k] = w[k] * n / sum;
+    t->alias[k] = k;
+    if (p[k] < 1.0)
+    {
+      small[ns++] = k;
+    }
+    else
+    {
+      large[nl++] = k;
+    }
+  }
+
+  while (ns && nl)
+  {
+    int s = small[--ns], l = large[nl - 1];
+
+    t->thresh[s] = (unsigned long)(p[s] * 4294967296.0);
+    t->alias[s] = l;
+    p[l] -= 1.0 - p[s];
+    if (p[l] < 1.0)
+    {
+      nl--;
+      small[ns++] = l;
+    }
+  }
+
+  // whatever is left is 1 up to rounding
+  while (nl)
+  {
+    t->thresh[large[--nl]] = 1UL << 32;
+  }
+  while (ns)
+  {
+    t->thresh[small[--ns]] = 1UL << 32;
+  }
+
+  return(0);
+}
+
+static int parse_item(prof_spec_t *sp, char *item)
+{
+  char *eq = strchr(item, '='), *end;
+  int *pct;
+  double val;
+
+  if (eq == NULL)
+  {
+    fprintf(stderr, "profile: \"%s\" is not key=value\n", item);
+    return(-1);
+  }
+  *eq = 0;
+
+  val = strtod(eq + 1, &end);
+  if (end == eq + 1 || *end || val < 0)
+  {
+    fprintf(stderr, "profile: bad value for %s\n", item);
+    return(-1);
+  }
+
+  pct = (strcmp(item, "lock") == 0)  ? &sp->lock_pct :
+        (strcmp(item, "split") == 0) ? &sp->split_pct :
+        (strcmp(item, "index") == 0) ? &sp->index_pct : NULL;
+  if (pct)
+  {
+    if (val > 100)
+    {
+      fprintf(stderr, "profile: %s is a percentage\n", item);
+      return(-1);
+    }
+    *pct = (int)val;
+    return(0);
+  }
+
+  for (int k = 0; k < NUM_KEYS; k++)
+  {
+    if (strcmp(item, prof_keys[k].name) == 0)
+    {
+      int g = prof_keys[k].group;
+
+      // first key of a group zeroes the rest of it
+      if (!sp->given[g])
+      {
+        memset(sp->w[g], 0, sizeof(sp->w[g]));
+        sp->given[g] = 1;
+      }
+      sp->w[g][prof_keys[k].index] = val;
+      return(0);
+    }
+  }
+
+  fprintf(stderr, "profile: unknown key \"%s\"\n", item);
+  return(-1);
+}
+
+// split on commas and whitespace, # comments run to the end of the line
+static int parse_text(prof_spec_t *sp, char *text)
+{
+  char *item, *save;
+
+  for (char *p = strchr(text, '#'); p; p = strchr(p, '#'))
+  {
+    while (*p && *p != '\n')
+    {
+      *p++ = ' ';
+    }
+  }
+
+  for (item = strtok_r(text, ", \t\r\n", &save); item; item = strtok_r(NULL, ", \t\r\n", &save))
+  {
+    if (parse_item(sp, item) == -1)
+    {
+      return(-1);
+    }
+  }
+
+  return(0);
+}
+
+static char *read_file(const char *path)
+{
+  FILE *f = fopen(path, "r");
+  char *buf;
+  long len;
+
+  if (f == NULL)
+  {
+    perror(path);
+    return(NULL);
+  }
+
+  fseek(f, 0, SEEK_END);
+  len = ftell(f);
+  rewind(f);
+
+  if ((buf = malloc(len + 1)) != NULL)
+  {
+    len = fread(buf, 1, len, f);
+    buf[len] = 0;
+  }
+  fclose(f);
+
+  return(buf);
+}
+
+int profile_parse(profile_t *prof, const char *spec)
+{
+  prof_spec_t sp;
+  char *text;
+  int rc;
+
+  // uniform unless told otherwise, as the generator has always been
+  for (int g = 0; g < NUM_GRPS; g++)
+  {
+    for (int k = 0; k < grp_len[g]; k++)
+    {
+      sp.w[g][k] = 1;
+    }
+    sp.given[g] = 0;
+  }
+  sp.lock_pct = 50;
+  sp.split_pct = 50;
+  sp.index_pct = 50;
+
+  text = (spec[0] == '@') ? read_file(spec + 1) : strdup(spec);
+  if (text == NULL)
+  {
+    return(-1);
+  }
+
+  rc = parse_text(&sp, text);
+  free(text);
+  if (rc == -1)
+  {
+    return(-1);
+  }
+
+  alias_t *tables[NUM_GRPS] = { &prof->type, &prof->size, &prof->disp, &prof->vec };
+  for (int g = 0; g < NUM_GRPS; g++)
+  {
+    if (alias_build(tables[g], sp.w[g], grp_len[g]) == -1)
+    {
+      fprintf(stderr, "profile: every %s weight is 0\n", grp_names[g]);
+      return(-1);
+    }
+  }
+  prof->lock_pct = sp.lock_pct;
+  prof->split_pct = sp.split_pct;
+  prof->index_pct = sp.index_pct;
+
+  return(0);
+}
+
+// probability of drawing k, recovered from the table
+static double alias_prob(const alias_t *t, int k)
+{
+  double p = 0;
+
+  for (int c = 0; c < t->n; c++)
+  {
+    double keep = t->thresh[c] / 4294967296.0;
+
+    p += (c == k) * keep + (t->alias[c] == k) * (1.0 - keep);
+  }
+
+  return(p / t->n);
+}
+
+void profile_print(FILE *out, const profile_t *prof)
+{
+  const alias_t *tables[NUM_GRPS] = { &prof->type, &prof->size, &prof->disp, &prof->vec };
+
+  for (int g = 0; g < NUM_GRPS; g++)
+  {
+    fprintf(out, "mix %s:", grp_names[g]);
+    for (int k = 0; k < NUM_KEYS; k++)
+    {
+      double p = (prof_keys[k].group == g) ? alias_prob(tables[g], prof_keys[k].index) : 0;
+
+      if (p > 0)
+      {
+        fprintf(out, " %s %.1f%%", prof_keys[k].name, 100 * p);
+      }
+    }
+    fprintf(out, "\n");
+  }
+  fprintf(out, "mix lock: %d%%, split: %d%%, index: %d%%\n", prof->lock_pct, prof->split_pct, prof->index_pct);
+}
@@ -0,0 +1,125 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ * Test case signatures, see include/signature.h
+ */
+
+#include <string.h>
+#include <nmmintrin.h>
+
+#include "signature.h"
+
+#define SIG_LANES      4            // independent crc chains, hides the crc32 latency
+#define CRC32C_POLY    0x82f63b78   // Castagnoli, bit reflected
+
+static unsigned int crc_table[256];
+static int have_sse42;
+
+void sig_init(void)
+{
+  for (unsigned int b = 0; b < 256; b++)
+  {
+    unsigned int crc = b;
+
+    for (int k = 0; k < 8; k++)
+    {
+      crc = (crc >> 1) ^ (CRC32C_POLY & -(crc & 1));
+    }
+    crc_table[b] = crc;
+  }
+
+  have_sse42 = __builtin_cpu_supports("sse4.2");
+}
+
+static inline unsigned int crc_u8_sw(unsigned int crc, unsigned char v)
+{
+  return(crc_table[(crc ^ v) & 0xff] ^ (crc >> 8));
+}
+
+static inline unsigned int crc_u64_sw(unsigned int crc, unsigned long v)
+{
+  for (int k = 0; k < 8; k++, v >>= 8)
+  {
+    crc = crc_u8_sw(crc, v);
+  }
+
+  return(crc);
+}
+
+static inline unsigned long load64(const unsigned char *p)
+{
+  unsigned long v;
+
+  memcpy(&v, p, sizeof(v));
+  return(v);
+}
+
+/*
+ * Function: lanes_sw, lanes_hw
+ *
+ * Description:
+ *    crc each of the SIG_LANES equal slices of p, per words long, then
+ *    the leftover bytes from p + tail into lane 0
+ */
+static void lanes_sw(const unsigned char *p, long per, long tail, long len, unsigned int *crc)
+{
+  for (long w = 0; w < per; w++)
+  {
+    for (int k = 0; k < SIG_LANES; k++)
+    {
+      crc[k] = crc_u64_sw(crc[k], load64(p + (k * per + w) * 8));
+    }
+  }
+
+  for (long b = tail; b < len; b++)
+  {
+    crc[0] = crc_u8_sw(crc[0], p[b]);
+  }
+}
+
+__attribute__((target("sse4.2")))
+static void lanes_hw(const unsigned char *p, long per, long tail, long len, unsigned int *crc)
+{
+  unsigned long c0 = crc[0], c1 = crc[1], c2 = crc[2], c3 = crc[3];
+  const unsigned char *p0 = p, *p1 = p + per * 8, *p2 = p + per * 16, *p3 = p + per * 24;
+
+  for (long w = 0; w < per * 8; w += 8)
+  {
+    c0 = _mm_crc32_u64(c0, load64(p0 + w));
+    c1 = _mm_crc32_u64(c1, load64(p1 + w));
+    c2 = _mm_crc32_u64(c2, load64(p2 + w));
+    c3 = _mm_crc32_u64(c3, load64(p3 + w));
+  }
+
+  for (long b = tail; b < len; b++)
+  {
+    c0 = _mm_crc32_u8(c0, p[b]);
+  }
+
+  crc[0] = c0;
+  crc[1] = c1;
+  crc[2] = c2;
+  crc[3] = c3;
+}
+
+unsigned long sig_hash(const volatile void *buf, long len, unsigned long seed)
+{
+  const unsigned char *p = (const unsigned char *)buf;
+  unsigned int crc[SIG_LANES] = { ~0U, ~0U, ~0U, ~0U };
+  long per = len / (8 * SIG_LANES);
+  unsigned long h;
+
+  if (have_sse42)
+  {
+    lanes_hw(p, per, per * 8 * SIG_LANES, len, crc);
+  }
+  else
+  {
+    lanes_sw(p, per, per * 8 * SIG_LANES, len, crc);
+  }
+
+  h = sig_chain(seed, len);
+  h = sig_chain(h, ((unsigned long)crc[0] << 32) | crc[1]);
+  return(sig_chain(h, ((unsigned long)crc[2] << 32) | crc[3]));
+}
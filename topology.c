@@ -0,0 +1,346 @@
+/*
+ * ECE550 Spring 2025 Project part 3
+ * R.E. Lamb, Harsha Duvvuru
+ *
+ * CPU topology discovery and thread placement, see include/topology.h
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+
+#include "topology.h"
+
+typedef struct
+{
+  int cpu;
+  int pkg;          // physical_package_id
+  int core;         // core_id, unique within a package
+  int sibling;      // rank among the SMT siblings of its core
+  int core_rank;    // rank of its core within the package
+} topo_cpu_t;
+
+// no sysfs topology (containers, odd kernels) falls back to dflt
+static int read_topo_id(int cpu, const char *name, int dflt)
+{
+  char path[128];
+  FILE *f;
+  int val = dflt;
+
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, name);
+  if ((f = fopen(path, "r")) == NULL)
+  {
+    return(dflt);
+  }
+
+  if (fscanf(f, "%d", &val) != 1)
+  {
+    val = dflt;
+  }
+  fclose(f);
+
+  return(val);
+}
+
+static int cmp_compact(const void *a, const void *b)
+{
+  const topo_cpu_t *x = a, *y = b;
+
+  if (x->pkg != y->pkg) return(x->pkg - y->pkg);
+  if (x->core != y->core) return(x->core - y->core);
+  return(x->cpu - y->cpu);
+}
+
+// one CPU per core before any SMT sibling, packages filled in turn
+static int cmp_core(const void *a, const void *b)
+{
+  const topo_cpu_t *x = a, *y = b;
+
+  if (x->sibling != y->sibling) return(x->sibling - y->sibling);
+  if (x->pkg != y->pkg) return(x->pkg - y->pkg);
+  return(x->core_rank - y->core_rank);
+}
+
+// one CPU per core before any SMT sibling, packages interleaved
+static int cmp_socket(const void *a, const void *b)
+{
+  const topo_cpu_t *x = a, *y = b;
+
+  if (x->sibling != y->sibling) return(x->sibling - y->sibling);
+  if (x->core_rank != y->core_rank) return(x->core_rank - y->core_rank);
+  return(x->pkg - y->pkg);
+}
+
+static int cmp_cpu(const void *a, const void *b)
+{
+  return(((const topo_cpu_t *)a)->cpu - ((const topo_cpu_t *)b)->cpu);
+}
+
+/*
+ * Function: parse_cpulist
+ *
+ * Description:
+ *    parse "0,2,8-11" style lists into a cpu_set_t
+ *
+ * Output:
+ *    0 on success, -1 on a malformed or empty list
+ */
+static int parse_cpulist(const char *list, cpu_set_t *set)
+{
+  const char *p = list;
+  char *end;
+
+  CPU_ZERO(set);
+
+  while (*p)
+  {
+    long lo = strtol(p, &end, 10), hi = lo;
+
+    if (end == p)
+    {
+      return(-1);
+    }
+
+    if (*end == '-')
+    {
+      p = end + 1;
+      hi = strtol(p, &end, 10);
+      if (end == p)
+      {
+        return(-1);
+      }
+    }
+
+    if (lo < 0 || hi < lo || hi >= CPU_SETSIZE)
+    {
+      return(-1);
+    }
+
+    for (long c = lo; c <= hi; c++)
+    {
+      CPU_SET(c, set);
+    }
+
+    p = end;
+    if (*p == ',')
+    {
+      p++;
+    }
+    else if (*p)
+    {
+      return(-1);
+    }
+  }
+
+  return(CPU_COUNT(set) ? 0 : -1);
+}
+
+// explicit lists are used in the order given, not sorted, and only name CPUs we may run on
+static int place_list(const char *list, const cpu_set_t *allowed, int nthreads, int *cpus)
+{
+  cpu_set_t check;
+  int order[CPU_SETSIZE];
+  int n = 0;
+  const char *p = list;
+
+  if (parse_cpulist(list, &check) == -1)
+  {
+    fprintf(stderr, "bad cpu list \"%s\"\n", list);
+    return(-1);
+  }
+
+  for (int c = 0; c < CPU_SETSIZE; c++)
+  {
+    if (CPU_ISSET(c, &check) && !CPU_ISSET(c, allowed))
+    {
+      fprintf(stderr, "cpu list \"%s\": cpu %d isn't available to this process (affinity or cpuset)\n", list, c);
+      return(-1);
+    }
+  }
+
+  while (*p && n < CPU_SETSIZE)
+  {
+    char *end;
+    long lo = strtol(p, &end, 10), hi = lo;
+
+    if (*end == '-')
+    {
+      hi = strtol(end + 1, &end, 10);
+    }
+
+    for (long c = lo; c <= hi && n < CPU_SETSIZE; c++)
+    {
+      order[n++] = c;
+    }
+
+    p = (*end == ',') ? end + 1 : end;
+  }
+
+  if (n < nthreads)
+  {
+    fprintf(stderr, "cpu list has %d cpus for %d threads, wrapping\n", n, nthreads);
+  }
+
+  for (int i = 0; i < nthreads; i++)
+  {
+    cpus[i] = order[i % n];
+  }
+
+  return(0);
+}
+
+int topo_place(const char *policy, const char *cpulist, int nthreads, int *cpus)
+{
+  cpu_set_t allowed;
+  topo_cpu_t *tc;
+  int n = 0;
+
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) == -1)
+  {
+    perror("sched_getaffinity");
+    return(-1);
+  }
+
+  if (cpulist)
+  {
+    return(place_list(cpulist, &allowed, nthreads, cpus));
+  }
+
+  if (policy == NULL)
+  {
+    policy = "linear";
+  }
+
+  if ((tc = calloc(CPU_SETSIZE, sizeof(topo_cpu_t))) == NULL)
+  {
+    perror("calloc");
+    return(-1);
+  }
+
+  for (int c = 0; c < CPU_SETSIZE; c++)
+  {
+    if (CPU_ISSET(c, &allowed))
+    {
+      tc[n].cpu = c;
+      tc[n].pkg = read_topo_id(c, "physical_package_id", 0);
+      tc[n].core = read_topo_id(c, "core_id", c);     // every CPU its own core
+      n++;
+    }
+  }
+
+  // sibling and core ranks come from the compact order
+  qsort(tc, n, sizeof(topo_cpu_t), cmp_compact);
+  for (int i = 0; i < n; i++)
+  {
+    if (i == 0 || tc[i].pkg != tc[i - 1].pkg)
+    {
+      tc[i].core_rank = 0;
+      tc[i].sibling = 0;
+    }
+    else if (tc[i].core != tc[i - 1].core)
+    {
+      tc[i].core_rank = tc[i - 1].core_rank + 1;
+      tc[i].sibling = 0;
+    }
+    else
+    {
+      tc[i].core_rank = tc[i - 1].core_rank;
+      tc[i].sibling = tc[i - 1].sibling + 1;
+    }
+  }
+
+  if (strcmp(policy, "linear") == 0)
+  {
+    qsort(tc, n, sizeof(topo_cpu_t), cmp_cpu);
+  }
+  else if (strcmp(policy, "compact") == 0)
+  {
+    // already in compact order
+  }
+  else if (strcmp(policy, "smt") == 0)
+  {
+    int m = 0;
+
+    // keep the first two siblings of every core that has them, in pairs
+    for (int i = 0; i < n; i++)
+    {
+      if (tc[i].sibling == 1)
+      {
+        tc[m++] = tc[i - 1];
+        tc[m++] = tc[i];
+      }
+    }
+
+    if (m == 0)
+    {
+      fprintf(stderr, "no SMT siblings available, using compact placement\n");
+      m = n;
+    }
+    n = m;
+  }
+  else if (strcmp(policy, "core") == 0)
+  {
+    qsort(tc, n, sizeof(topo_cpu_t), cmp_core);
+  }
+  else if (strcmp(policy, "socket") == 0)
+  {
+    qsort(tc, n, sizeof(topo_cpu_t), cmp_socket);
+  }
+  else if (strcmp(policy, "spread") != 0)
+  {
+    fprintf(stderr, "unknown placement policy \"%s\"\n", policy);
+    free(tc);
+    return(-1);
+  }
+
+  if (nthreads > n)
+  {
+    fprintf(stderr, "%d threads on %d cpus, oversubscribing\n", nthreads, n);
+  }
+
+  for (int i = 0; i < nthreads; i++)
+  {
+    if (strcmp(policy, "spread") == 0 && nthreads <= n)
+    {
+      cpus[i] = tc[(long)i * n / nthreads].cpu;
+    }
+    else
+    {
+      cpus[i] = tc[i % n].cpu;
+    }
+  }
+
+  free(tc);
+  return(0);
+}
+
+int bind_to_cpu(int cpu)
+{
+  cpu_set_t set;
+
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+
+  if (sched_setaffinity(0, sizeof(cpu_set_t), &set) == -1)
+  {
+    perror("sched_setaffinity");
+    return(-1);
+  }
+
+  return(0);
+}
+
+int topo_ncpus(void)
+{
+  cpu_set_t allowed;
+
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) == -1)
+  {
+    perror("sched_getaffinity");
+    return(1);
+  }
+
+  return(CPU_COUNT(&allowed));
+}